@@ -3,9 +3,15 @@
 #include "App.h"
 
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
 #include <iostream>
 #include <vector>
 
+#include "graphics/Bundle.h"
+#include "graphics/GpuTracker.h"
 #include "graphics/Shader.h"
 #include "graphics/Texture.h"
 #include "graphics/Mesh.h"
@@ -38,21 +44,67 @@ int App::Execute()
     glClearColor(0.0, 0.0, 0.0, 1.0);
 
     while (m_running) {
+        ReloadChangedFiles();
+        PollShaders();
+        m_assetLoader.Update(ASSET_UPLOAD_BUDGET);
         Update();
         RenderToDepthMap();
         Render();
+        m_textureStreamer.Update(m_assetLoader.GetUploadRing());
 
         if (glfwWindowShouldClose(m_window) == GL_TRUE) {
             m_running = false;
         }
     }
 
-    glfwDestroyWindow(m_window);
-    glfwTerminate();
+    if (m_benchEntities > 0 && m_drawCount > 0) {
+        std::cout << "Entity::Draw: " << m_drawTime / m_drawCount * 1e9 << " ns CPU per call over " <<
+                m_drawCount << " calls" << std::endl;
+    }
+    m_assetCache.PrintStats();
+    m_assetLoader.PrintStats();
+    m_textureStreamer.PrintStats();
+    m_textureRegistry.PrintStats();
+    m_samplerCache.PrintStats();
+    m_uniformRing->PrintStats();
+    Mesh::PrintStats();
+    Shader::PrintStats();
+    GpuTracker::PrintStats();
+
+    Shutdown();
 
     return 0;
 }
 
+/*
+ * Releases every GL object while the context is still current, so the
+ * leak report covers what the app really left behind, and only then
+ * destroys the window.
+ */
+void App::Shutdown()
+{
+    m_assetLoader.Shutdown();
+    ClearEntities();
+    m_textures.clear();
+    m_meshes.clear();
+    m_shaders.clear();
+    m_uniformRing.reset();
+    m_samplers.clear();
+    m_samplerCache.Clear();
+    if (m_fbo) {
+        GpuTracker::Untrack(GPU_OBJECT_TEXTURE, m_depthMap);
+        glDeleteTextures(1, &m_depthMap);
+        GpuTracker::Untrack(GPU_OBJECT_FRAMEBUFFER, m_fbo);
+        glDeleteFramebuffers(1, &m_fbo);
+        m_fbo = 0;
+    }
+
+    GpuTracker::ReportLeaks();
+
+    glfwDestroyWindow(m_window);
+    glfwTerminate();
+}
+
 double App::GetDeltaTime() const
 {
     return m_deltaTime;
@@ -117,10 +169,7 @@ void App::RenderToDepthMap()
     m_lightPV = lightProj * lightView;
 
     for (Entity* entity : m_entities) {
-        Shader *shaderStore = entity->m_shader;
-        entity->m_shader = &m_shaders[SHADER_LIGHT];
-        entity->Draw(m_lightPV);
-        entity->m_shader = shaderStore;
+        entity->DrawDepth(&m_shaders[SHADER_LIGHT], m_lightPV);
     }
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -143,20 +192,53 @@ void App::Render()
         pv = glm::rotate(pv, -m_viewAngle,
                 glm::vec3(1.0, 0.0, 0.0)); 
 
-        m_shaders[SHADER_LIGHTING].SetUniform("viewPos", m_viewPos);
-        m_shaders[SHADER_LIGHTING].SetUniform("lightSpaceTransform", m_lightPV);
-        m_shaders[SHADER_LIGHTING].SetUniform("shadowMap", 1);
+        float pixelsPerUnit = m_screenHeight / (2.0f * std::tan(glm::radians(45.0f) / 2.0f));
+        m_textureStreamer.BeginFrame(m_viewPos, pixelsPerUnit);
+
+        m_uniformRing->BeginFrame();
+        FrameBlock frame = {};
+        frame.lightSpaceTransform = m_lightPV;
+        frame.viewPos = m_viewPos;
+        size_t frameOffset = m_uniformRing->Push(frame);
+        LightBlock light = {};
+        light.position = m_lightPos;
+        light.color = m_lightColor;
+        size_t lightOffset = m_uniformRing->Push(light);
+        m_materialOffsets.clear();
+        for (Entity *entity : m_entities) {
+            m_materialOffsets.push_back(m_uniformRing->Push(entity->GetMaterial()));
+        }
+        m_uniformRing->Upload();
+        m_uniformRing->Bind(BLOCK_FRAME, frameOffset, sizeof(FrameBlock));
+        m_uniformRing->Bind(BLOCK_LIGHT, lightOffset, sizeof(LightBlock));
+
+        m_shaders[SHADER_LIGHTING].SetUniform(UNIFORM_SHADOW_MAP, 1);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, m_depthMap);
+        m_samplerCache.Bind(0, m_samplers[SAMPLER_TEXTURE]);
+        m_samplerCache.Bind(1, m_samplers[SAMPLER_SHADOW]);
+        m_samplerCache.Bind(2, m_samplers[SAMPLER_TEXTURE_ARRAY]);
 
 
-        for (Entity *entity : m_entities) {
-            entity->Draw(pv);
+        std::chrono::steady_clock::time_point drawStart;
+        if (m_benchEntities > 0) {
+            drawStart = std::chrono::steady_clock::now();
+        }
+        for (size_t i = 0; i < m_entities.size(); ++i) {
+            m_uniformRing->Bind(BLOCK_MATERIAL, m_materialOffsets[i], sizeof(MaterialBlock));
+            m_entities[i]->Draw(pv);
         }
-    } else if (m_curScene == 2) {
+        if (m_benchEntities > 0) {
+            m_drawTime += std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                    drawStart).count();
+            m_drawCount += m_entities.size();
+        }
+        m_uniformRing->EndFrame();
+    } else if (m_curScene == 2 && m_shaders[SHADER_QUAD].IsReady()) {
         m_shaders[SHADER_QUAD].Use();
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, m_depthMap);
+        m_samplerCache.Bind(0, m_samplers[SAMPLER_SHADOW]);
         m_meshes[MESH_SQUARE].Draw();
     }
 
@@ -205,16 +287,32 @@ int App::Init()
 
     app = this;
 
+    if (const char *bench = std::getenv("MG3_DRAW_BENCH")) {
+        m_benchEntities = std::max(std::atoi(bench), 0);
+        std::cout << "Draw benchmark with " << m_benchEntities << " extra entities" << std::endl;
+    }
+
+    /* Assets come from the bundle if it has been built */
+    Bundle::Mount("assets.pak");
+    if (!Bundle::IsMounted()) {
+        m_fileWatcher.Watch("res");
+        m_fileWatcher.Watch("graphics/shaders");
+    } else {
+        std::cout << "Assets come from the bundle, hot reload is off" << std::endl;
+    }
+
+    GpuTracker::SetBudget(GPU_MEMORY_BUDGET);
+
     glGenFramebuffers(1, &m_fbo);
     glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    GPU_TRACK(GPU_OBJECT_FRAMEBUFFER, m_fbo, GPU_FRAMEBUFFER, 0, "shadow FBO");
     glGenTextures(1, &m_depthMap);
     glBindTexture(GL_TEXTURE_2D, m_depthMap);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
                  SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // Drivers store GL_DEPTH_COMPONENT as 24 or 32 bits
+    GPU_TRACK(GPU_OBJECT_TEXTURE, m_depthMap, GPU_FRAMEBUFFER, SHADOW_WIDTH * SHADOW_HEIGHT * 4,
+            "shadow map");
 
     glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthMap, 0);
@@ -222,6 +320,9 @@ int App::Init()
     glReadBuffer(GL_NONE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    m_uniformRing = std::make_unique<UniformRing>(UNIFORM_RING_FRAME_SIZE);
+
+    InitSamplers();
     InitMeshes();
     InitShaders();
     InitTextures();
@@ -249,9 +350,6 @@ void App::InitScene1()
     m_lightPos = {-3.5, 8.0, 3.5};
     m_lightColor = {1.0, 1.0, 1.0};
 
-    m_shaders[SHADER_LIGHTING].SetUniform("lightColor", m_lightColor);
-    m_shaders[SHADER_LIGHTING].SetUniform("lightPos", m_lightPos);
-
     /*
     Entity *lightEntity = new Entity(
             &m_meshes[MESH_CUBE],
@@ -267,7 +365,7 @@ void App::InitScene1()
     m_cube = new Entity(
             &m_meshes[MESH_CUBE],
             &m_shaders[SHADER_LIGHTING],
-            &m_textures[TEXTURE_GOLD]);
+            m_textures[TEXTURE_GOLD].get());
     m_cube->m_rotAxis = glm::normalize(glm::vec3(2.0, 3.0, 1.0));
     m_cube->m_angle = glm::radians(-120.0);
     m_cube->m_position = glm::vec3(-1.0, 4.6, -0.5);
@@ -312,20 +410,47 @@ void App::InitScene1()
     m_entities.push_back(m_plane);
 
     // debugQuad
+
+    // Draw benchmark: a grid of small textured cubes over the plane
+    int side = static_cast<int>(std::ceil(std::sqrt(m_benchEntities)));
+    for (int i = 0; i < m_benchEntities; ++i) {
+        Entity *cube = new Entity(
+                &m_meshes[MESH_CUBE],
+                &m_shaders[SHADER_LIGHTING],
+                m_textures[TEXTURE_GOLD].get());
+        cube->m_position = glm::vec3((i % side - side / 2) * 0.2, -0.9, (i / side - side / 2) * 0.2);
+        cube->m_scale *= 0.05;
+        m_entities.push_back(cube);
+    }
+}
+
+void App::InitSamplers()
+{
+    SamplerDesc texture;
+    texture.anisotropy = MAX_ANISOTROPY;
+    m_samplers.push_back(m_samplerCache.Get(texture));
+
+    SamplerDesc textureArray = texture;
+    textureArray.wrapS = textureArray.wrapT = GL_CLAMP_TO_EDGE;
+    m_samplers.push_back(m_samplerCache.Get(textureArray));
+
+    SamplerDesc shadow;
+    shadow.minFilter = shadow.magFilter = GL_NEAREST;
+    m_samplers.push_back(m_samplerCache.Get(shadow));
 }
 
 void App::InitMeshes()
 {
-    std::vector<GLushort> emptyInds = {};
+    std::vector<GLuint> emptyInds = {};
     std::vector<VertexN> vertices;
-    std::vector<GLushort> inds;
+    std::vector<GLuint> inds;
     // MESH_TRIANGLE
     vertices = {
         {{-1.0, -sqrt(3.0)/3.0, 0.0}, {0.0, 0.0}, {0.0, 0.0, 1.0}},
         {{ 1.0, -sqrt(3.0)/3.0, 0.0}, {1.0, 0.0}, {0.0, 0.0, 1.0}},
         {{ 0.0, 2.0 * sqrt(3.0)/3.0, 0.0}, {0.5, sqrt(3.0)/4.0}, {0.0, 0.0, 1.0}}
     };
-    m_meshes.emplace_back(vertices, emptyInds);
+    m_meshes.emplace_back(vertices, emptyInds, Mesh::FLAG_DEPTH_STREAM);
 
     // MESH_SQUARE
     vertices = {
@@ -338,26 +463,83 @@ void App::InitMeshes()
         0, 1, 2,
         2, 3, 0
     };
-    m_meshes.emplace_back(vertices, inds);
+    m_meshes.emplace_back(vertices, inds, Mesh::FLAG_DEPTH_STREAM);
 
     // MESH_CUBE
-    auto p = ReadMesh("res/cube.mesh");
-    m_meshes.emplace_back(p.first, p.second);
+    m_meshes.emplace_back();
+    auto loadCube = [this]() {
+        m_assetLoader.LoadMesh(&m_meshes[MESH_CUBE], "res/cube", true,
+                Mesh::FLAG_PACKED | Mesh::FLAG_DEPTH_STREAM);
+    };
+    loadCube();
+    WatchFile("res/cube.mesh", loadCube);
+    WatchFile("res/cube.meshb", loadCube);
 }
 
 void App::InitShaders()
 {
-    m_shaders.emplace_back("graphics/shaders/basic.vert", "graphics/shaders/basic.frag");
-    m_shaders.emplace_back("graphics/shaders/lighting.vert", "graphics/shaders/lighting.frag");
-    m_shaders[SHADER_LIGHTING].SetUniform("texture0", 0);
-    m_shaders.emplace_back("graphics/shaders/light.vert", "graphics/shaders/lighting.frag");
-    m_shaders.emplace_back("graphics/shaders/quad.vert", "graphics/shaders/quad.frag");
+    Shader::SetBinaryCache(&m_assetCache);
+    const char *sources[][2] = {
+        {"graphics/shaders/basic.vert", "graphics/shaders/basic.frag"},
+        {"graphics/shaders/lighting.vert", "graphics/shaders/lighting.frag"},
+        {"graphics/shaders/light.vert", "graphics/shaders/light.frag"},
+        {"graphics/shaders/quad.vert", "graphics/shaders/quad.frag"}
+    };
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); ++i) {
+        m_shaders.emplace_back(sources[i][0], sources[i][1]);
+        auto reload = [this, i]() { m_shaders[i].Reload(); };
+        WatchFile(sources[i][0], reload);
+        WatchFile(sources[i][1], reload);
+    }
+}
+
+// Frames draw with whichever programs the driver has finished so far
+void App::PollShaders()
+{
+    bool built = false;
+    for (Shader &shader : m_shaders) {
+        if (shader.Poll()) {
+            built = true;
+        }
+    }
+    if (built) {
+        SetShaderConstants();
+    }
+}
+
+void App::SetShaderConstants()
+{
+    m_shaders[SHADER_LIGHTING].SetUniform("textureArray", 2);
     m_shaders[SHADER_QUAD].SetUniform("texture0", 0);
 }
 
 void App::InitTextures()
 {
-    m_textures.emplace_back("res/gold.jpg");
+    m_textures.push_back(m_textureRegistry.Acquire("res/gold.jpg"));
+    WatchFile("res/gold.jpg", [this]() { m_textureRegistry.Reload("res/gold.jpg"); });
+}
+
+void App::WatchFile(const std::string &path, std::function<void()> reload)
+{
+    m_reloaders[std::filesystem::path(path).lexically_normal().string()].push_back(reload);
+}
+
+/*
+ * Between frames, so nothing is drawn from a half-replaced asset. Meshes and
+ * textures are rebuilt by the loader and swapped in by its Update.
+ */
+void App::ReloadChangedFiles()
+{
+    for (const std::string &path : m_fileWatcher.Poll()) {
+        auto reloaders = m_reloaders.find(std::filesystem::path(path).lexically_normal().string());
+        if (reloaders == m_reloaders.end()) {
+            continue;
+        }
+        std::cout << "Changed: " << path << std::endl;
+        for (auto &reload : reloaders->second) {
+            reload();
+        }
+    }
 }
 
 double App::GetRand(double l, double r)
@@ -4,18 +4,27 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "graphics/AssetLoader.h"
 #include "graphics/Entity.h"
+#include "graphics/FileWatcher.h"
 #include "graphics/Mesh.h"
+#include "graphics/SamplerCache.h"
 #include "graphics/Shader.h"
 #include "graphics/Texture.h"
+#include "graphics/TextureManager.h"
+#include "graphics/TextureRegistry.h"
+#include "graphics/TextureStreamer.h"
+#include "graphics/UniformRing.h"
+#include "ReadMesh.h"
 
-
+#include <functional>
 #include <list>
+#include <memory>
+#include <unordered_map>
 
 #define M_PI           3.14159265358979323846
 
 /* Forward declarations */
-extern std::pair<std::vector<VertexN>, std::vector<GLushort>> ReadMesh(const std::string &path);
 class ParticleEntity;
 
 class App
@@ -36,8 +45,9 @@ public:
         SHADOW_WIDTH = 1024,
         SHADOW_HEIGHT = 1024
     };
-    GLuint                                       m_fbo;
-    GLuint                                       m_depthMap;
+    GLuint                                       m_fbo = 0;
+    GLuint                                       m_depthMap = 0;
+    static constexpr size_t GPU_MEMORY_BUDGET = 512 << 20; // warns past it
 
     // Entities
     std::vector<Entity *>                        m_entities;
@@ -74,14 +84,53 @@ public:
     };
     std::vector<Shader>                          m_shaders;
     void InitShaders();
+    void PollShaders();
+    void SetShaderConstants(); // again whenever a program is (re)built
+
+    // Frame, light and material blocks, written once per frame. Needs the GL context
+    static constexpr size_t UNIFORM_RING_FRAME_SIZE = 256 << 10;
+    std::unique_ptr<UniformRing>                 m_uniformRing;
+    std::vector<size_t>                          m_materialOffsets;
 
-    // Textures
+    // Textures, packed into texture arrays. Handles in m_textures
     enum {
         TEXTURE_GOLD
     };
-    std::vector<Texture>                         m_textures;
+    static constexpr int TEXTURE_RESIDENT_SIZE = 64; // largest level loaded up front
+    static constexpr size_t TEXTURE_BUDGET = 64 << 20;
+    TextureManager                               m_textureManager{16, TEXTURE_RESIDENT_SIZE};
+    TextureStreamer                              m_textureStreamer{&m_textureManager, TEXTURE_BUDGET};
     void InitTextures();
 
+    // Samplers, by texture unit use
+    enum {
+        SAMPLER_TEXTURE = 0,
+        SAMPLER_TEXTURE_ARRAY,
+        SAMPLER_SHADOW
+    };
+    static constexpr float MAX_ANISOTROPY = 8.0;
+    SamplerCache                                 m_samplerCache;
+    std::vector<GLuint>                          m_samplers;
+    void InitSamplers();
+
+    // Background loading of meshes and textures
+    static constexpr double ASSET_UPLOAD_BUDGET = 0.004; // seconds per frame
+    static constexpr uint64_t ASSET_CACHE_SIZE = 256 << 20;
+    static constexpr size_t PIXEL_UPLOAD_RING_SIZE = 16 << 20;
+    AssetCache                                   m_assetCache{".cache", ASSET_CACHE_SIZE};
+    AssetLoader                                  m_assetLoader{&m_assetCache, 0, 16,
+                                                               PIXEL_UPLOAD_RING_SIZE};
+    // After the loader: handles release their layers through the registry
+    TextureRegistry                              m_textureRegistry{&m_textureManager,
+                                                                   &m_assetLoader};
+    std::vector<TextureRegistry::Handle>         m_textures;
+
+    // Hot reload of loose files, off while the bundle is mounted
+    FileWatcher                                  m_fileWatcher;
+    std::unordered_map<std::string, std::vector<std::function<void()>>> m_reloaders;
+    void WatchFile(const std::string &path, std::function<void()> reload);
+    void ReloadChangedFiles();
+
     // Input
     enum {
         INPUT_1 = 0,
@@ -99,6 +148,8 @@ private:
     void Render();
     void RenderToDepthMap();
     
+    // Needs the GL context, ends with the window destroyed
+    void Shutdown();
     void ClearEntities();
     void InitScene1();
 
@@ -109,6 +160,11 @@ private:
     int                                          m_curScene;
 
     bool                                         m_running = true;
+
+    // MG3_DRAW_BENCH=<count> adds that many entities and reports the CPU cost per draw
+    int                                          m_benchEntities = 0;
+    double                                       m_drawTime = 0.0;
+    uint64_t                                     m_drawCount = 0;
     double                                       m_time;
     double                                       m_prevTime;
     double                                       m_deltaTime;
@@ -1,42 +1,167 @@
 #include "GL/glew.h"
 
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+#include <thread>
 #include <utility>
 #include <vector>
-#include <iostream>
-#include <sstream>
-#include <fstream>
 
-#include "graphics/Vertex.h"
+#include "ReadMesh.h"
+#include "graphics/MappedFile.h"
+
+namespace {
+
+enum {
+    PARALLEL_MIN_SIZE = 1 << 20,                // bytes
+    PARALLEL_MIN_CHUNK = 1 << 14                // vertices
+};
+
+inline bool IsSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline const char *SkipSpace(const char *p, const char *end)
+{
+    while (p != end && IsSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+template <class T>
+inline bool ParseNumber(const char *&p, const char *end, T &val)
+{
+    p = SkipSpace(p, end);
+    auto [next, ec] = std::from_chars(p, end, val);
+    p = next;
+    return ec == std::errc();
+}
+
+// Parses n vertices, one per 8 numbers: pos, texCoords, normal
+bool ParseVertices(const char *&p, const char *end, VertexN *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        VertexN &v = out[i];
+        if (!ParseNumber(p, end, v.pos.x) || !ParseNumber(p, end, v.pos.y) ||
+                !ParseNumber(p, end, v.pos.z) ||
+                !ParseNumber(p, end, v.texCoords.x) || !ParseNumber(p, end, v.texCoords.y) ||
+                !ParseNumber(p, end, v.normal.x) || !ParseNumber(p, end, v.normal.y) ||
+                !ParseNumber(p, end, v.normal.z)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Splits the vertex section into line-aligned chunks and parses them
+ * concurrently. Assumes one vertex per non-blank line, which is what the
+ * exporter writes; returns false if the file does not follow it.
+ */
+bool ParseVerticesParallel(const char *&p, const char *end, VertexN *out, size_t n,
+        unsigned threads)
+{
+    size_t chunkSize = (n + threads - 1) / threads;
+    std::vector<const char *> chunkBegin;
+    const char *line = p;
+    size_t lines = 0;
+    while (lines < n) {
+        line = SkipSpace(line, end);
+        if (line == end) {
+            return false;
+        }
+        if (lines % chunkSize == 0) {
+            chunkBegin.push_back(line);
+        }
+        ++lines;
+        line = std::find(line, end, '\n');
+    }
+    chunkBegin.push_back(line);
+
+    size_t chunks = chunkBegin.size() - 1;
+    std::vector<char> ok(chunks, false);
+    std::vector<std::thread> workers;
+    for (size_t c = 0; c < chunks; ++c) {
+        workers.emplace_back([&, c]() {
+            const char *q = chunkBegin[c];
+            size_t first = c * chunkSize;
+            size_t count = std::min(chunkSize, n - first);
+            ok[c] = ParseVertices(q, chunkBegin[c + 1], out + first, count) &&
+                    SkipSpace(q, chunkBegin[c + 1]) == chunkBegin[c + 1];
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    if (std::find(ok.begin(), ok.end(), false) != ok.end()) {
+        return false;
+    }
+    p = line;
+    return true;
+}
+
+unsigned PickThreads(size_t fileSize, size_t vertexCount)
+{
+    if (fileSize < PARALLEL_MIN_SIZE) {
+        return 1;
+    }
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min(threads, vertexCount / PARALLEL_MIN_CHUNK));
+}
+
+}
 
 // Reads only pos and normal
-std::pair<std::vector<VertexN>, std::vector<GLushort>> ReadMesh(const std::string &path)
+std::pair<std::vector<VertexN>, std::vector<GLuint>> ReadMesh(const std::string &path,
+        unsigned threads)
 {
-    std::fstream file;
     std::vector<VertexN> V;
-    std::vector<GLushort> I;
-    try {
-        file.open(path);
-        std::stringstream ss;
-        ss << file.rdbuf();
-        unsigned n;
-        ss >> n;
-        for (unsigned i = 0; i < n; ++i) {
-            glm::vec3 p;
-            glm::vec2 tc;
-            glm::vec3 normal;
-            ss >> p.x >> p.y >> p.z >> tc.x >> tc.y >>
-                    normal.x >> normal.y >> normal.z;
-            V.push_back({p, tc, normal});
+    std::vector<GLuint> I;
+
+    MappedFile file(path);
+    if (!file.IsOpen()) {
+        std::cerr << "Could not open mesh file: " << path << std::endl;
+        return {V, I};
+    }
+    const char *p = reinterpret_cast<const char *>(file.Data());
+    const char *end = p + file.Size();
+
+    unsigned n;
+    if (!ParseNumber(p, end, n)) {
+        std::cerr << "Malformed mesh file: " << path << std::endl;
+        return {V, I};
+    }
+    V.resize(n);
+    if (threads == 0) {
+        threads = PickThreads(file.Size(), n);
+    }
+    const char *vertexSection = p;
+    if (threads <= 1 || !ParseVerticesParallel(p, end, V.data(), n, threads)) {
+        p = vertexSection;
+        if (!ParseVertices(p, end, V.data(), n)) {
+            std::cerr << "Malformed vertex data in mesh file: " << path << std::endl;
+            V.clear();
+            return {V, I};
         }
-        ss >> n;
-        for (unsigned i = 0; i < n; ++i) {
-            GLushort ind;
-            ss >> ind;
-            I.push_back(ind);
+    }
+
+    if (!ParseNumber(p, end, n)) {
+        std::cerr << "Malformed mesh file: " << path << std::endl;
+        V.clear();
+        return {V, I};
+    }
+    I.resize(n);
+    for (unsigned i = 0; i < n; ++i) {
+        unsigned ind;
+        if (!ParseNumber(p, end, ind) || ind >= V.size()) {
+            std::cerr << "Malformed index data in mesh file: " << path << std::endl;
+            V.clear();
+            I.clear();
+            return {V, I};
         }
-    } catch (std::fstream::failure &e) {
-        std::cerr << "Could not open mesh file: " << path << std::endl;
-        std::cerr << e.what() << std::endl;
+        I[i] = ind;
     }
     return {V, I};
 }
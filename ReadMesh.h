@@ -0,0 +1,15 @@
+#ifndef READMESH_H
+#define READMESH_H
+
+#include <GL/glew.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "graphics/Vertex.h"
+
+// threads == 0 picks the thread count from the file size
+std::pair<std::vector<VertexN>, std::vector<GLuint>> ReadMesh(const std::string &path,
+        unsigned threads = 0);
+
+#endif
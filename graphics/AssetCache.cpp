@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "AssetCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bump when the layout of cached blobs changes
+const char CACHE_FORMAT[] = "mg3-cache-1";
+// Temporary blobs older than this were left by a crashed or failed writer
+const auto STALE_TEMP_AGE = std::chrono::minutes(10);
+
+}
+
+AssetCache::AssetCache(const std::string &dir, uint64_t sizeCap) :
+    m_dir(dir),
+    m_sizeCap(sizeCap)
+{
+    std::error_code ec;
+    fs::create_directories(m_dir, ec);
+    if (ec) {
+        std::cerr << "Could not create asset cache directory " << m_dir << ": " <<
+                ec.message() << std::endl;
+    }
+    RemoveStaleTemps();
+}
+
+std::string AssetCache::MakeKey(const std::string &sourcePath, const std::string &options) const
+{
+    return MakeKey(std::vector<std::string>{sourcePath}, options);
+}
+
+std::string AssetCache::MakeKey(const std::vector<std::string> &sourcePaths,
+        const std::string &options) const
+{
+    uint64_t h = Fnv1a(CACHE_FORMAT, sizeof(CACHE_FORMAT));
+    h = Fnv1a(options.data(), options.size(), h);
+    for (const std::string &sourcePath : sourcePaths) {
+        MappedFile source(sourcePath);
+        if (!source.IsOpen()) {
+            return "";
+        }
+        // The size delimits the sources, so bytes moved from one to the next change the key
+        uint64_t size = source.Size();
+        h = Fnv1a(&size, sizeof(size), h);
+        h = Fnv1a(source.Data(), source.Size(), h);
+    }
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(h));
+    return key;
+}
+
+bool AssetCache::Lookup(const std::string &key, std::string &path)
+{
+    std::string blob = GetBlobPath(key);
+    std::error_code ec;
+    bool found = fs::exists(blob, ec);
+    if (found) {
+        // The modification time doubles as the LRU timestamp
+        fs::last_write_time(blob, fs::file_time_type::clock::now(), ec);
+        path = blob;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (found) {
+        ++m_stats.hits;
+    } else {
+        ++m_stats.misses;
+    }
+    return found;
+}
+
+std::string AssetCache::GetTempPath(const std::string &key) const
+{
+    std::hash<std::thread::id> hasher;
+    return GetBlobPath(key) + ".tmp" + std::to_string(hasher(std::this_thread::get_id()));
+}
+
+bool AssetCache::Commit(const std::string &key)
+{
+    std::error_code ec;
+    fs::rename(GetTempPath(key), GetBlobPath(key), ec);
+    if (ec) {
+        std::cerr << "Could not store cached asset " << key << ": " << ec.message() << std::endl;
+        Discard(key);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.stores;
+    Evict();
+    return true;
+}
+
+void AssetCache::Discard(const std::string &key)
+{
+    std::error_code ec;
+    fs::remove(GetTempPath(key), ec);
+}
+
+AssetCache::Stats AssetCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void AssetCache::PrintStats() const
+{
+    Stats stats = GetStats();
+    std::cout << "Asset cache: " << stats.hits << " hits, " << stats.misses << " misses, " <<
+            stats.stores << " stored, " << stats.evictions << " evicted" << std::endl;
+}
+
+std::string AssetCache::GetBlobPath(const std::string &key) const
+{
+    return (fs::path(m_dir) / (key + ".blob")).string();
+}
+
+void AssetCache::RemoveStaleTemps()
+{
+    auto staleBefore = fs::file_time_type::clock::now() - STALE_TEMP_AGE;
+    std::error_code ec;
+    for (const fs::directory_entry &e : fs::directory_iterator(m_dir, ec)) {
+        if (e.path().filename().string().find(".blob.tmp") == std::string::npos) {
+            continue;
+        }
+        std::error_code timeError;
+        if (e.last_write_time(timeError) < staleBefore && !timeError) {
+            fs::remove(e.path(), timeError);
+        }
+    }
+}
+
+// Called with m_mutex held
+void AssetCache::Evict()
+{
+    struct Entry
+    {
+        fs::path path;
+        fs::file_time_type time;
+        uint64_t size;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (const fs::directory_entry &e : fs::directory_iterator(m_dir, ec)) {
+        if (e.path().extension() != ".blob") {
+            continue;
+        }
+        Entry entry = {e.path(), e.last_write_time(ec), e.file_size(ec)};
+        total += entry.size;
+        entries.push_back(entry);
+    }
+    if (total <= m_sizeCap) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.time < b.time;
+    });
+    for (const Entry &entry : entries) {
+        if (total <= m_sizeCap) {
+            break;
+        }
+        if (fs::remove(entry.path, ec)) {
+            total -= entry.size;
+            ++m_stats.evictions;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef GRAPHICS_ASSETCACHE_H
+#define GRAPHICS_ASSETCACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * On-disk cache of processed assets. Blobs are keyed by a hash of the
+ * source file contents and the processing options, so editing a source
+ * or changing options simply misses. The least recently used blobs are
+ * evicted once the directory grows over its size cap.
+ */
+class AssetCache
+{
+public:
+    struct Stats
+    {
+        unsigned                                hits = 0;
+        unsigned                                misses = 0;
+        unsigned                                stores = 0;
+        unsigned                                evictions = 0;
+    };
+
+    AssetCache(const std::string &dir, uint64_t sizeCap);
+    AssetCache(const AssetCache &other) = delete;
+
+    // Empty if the source can't be read
+    std::string MakeKey(const std::string &sourcePath, const std::string &options) const;
+    // A blob built from several sources, e.g. the stages of a shader program
+    std::string MakeKey(const std::vector<std::string> &sourcePaths,
+            const std::string &options) const;
+
+    // Sets path to the cached blob for key and marks it as recently used
+    bool Lookup(const std::string &key, std::string &path);
+    // Blobs are written to a temporary path and published by Commit(),
+    // a failed write is cleaned up by Discard()
+    std::string GetTempPath(const std::string &key) const;
+    bool Commit(const std::string &key);
+    void Discard(const std::string &key);
+
+    Stats GetStats() const;
+    void PrintStats() const;
+
+private:
+    std::string GetBlobPath(const std::string &key) const;
+    void RemoveStaleTemps();
+    void Evict();
+
+private:
+    std::string                                 m_dir;
+    uint64_t                                    m_sizeCap;
+
+    mutable std::mutex                          m_mutex;
+    Stats                                       m_stats;
+};
+
+#endif
@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+
+#include "AssetLoader.h"
+#include "BlockCompress.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "MeshOptimize.h"
+#include "MipChain.h"
+#include "TextureManager.h"
+#include "../ReadMesh.h"
+
+namespace {
+
+// Levels staged together start on SIMD-friendly offsets
+const size_t STAGED_LEVEL_ALIGNMENT = 64;
+
+std::vector<TextureLevel> ImageLevels(const std::vector<Image> &images)
+{
+    std::vector<TextureLevel> levels;
+    for (const Image &image : images) {
+        levels.push_back({image.width, image.height, image.pixels.data(), image.pixels.size()});
+    }
+    return levels;
+}
+
+std::vector<TextureLevel> FileLevels(const TextureFile &file)
+{
+    std::vector<TextureLevel> levels;
+    for (size_t i = 0; i < file.GetLevelCount(); ++i) {
+        levels.push_back(file.GetLevel(i));
+    }
+    return levels;
+}
+
+/*
+ * A texture file's levels padded to their layer size. Formats the driver
+ * can't sample are decoded to RGBA8 and format is set to what the levels
+ * hold. Empty if a level can't be decoded.
+ */
+std::vector<Image> PadFileLevels(const TextureFile &file, uint32_t &format)
+{
+    std::vector<TextureLevel> levels = FileLevels(file);
+    int width = levels.front().width, height = levels.front().height;
+    format = file.GetFormat();
+    if (IsBlockCompressed(format) && Texture::IsFormatSupported(format)) {
+        return TextureArray::PadBlocks(format, levels, TextureManager::LayerSize(width, format),
+                TextureManager::LayerSize(height, format));
+    }
+    std::vector<Image> images;
+    for (const TextureLevel &level : levels) {
+        Image image;
+        if (format == KTX2_FORMAT_R8G8B8A8_UNORM) {
+            image = {level.width, level.height,
+                std::vector<unsigned char>(level.data, level.data + level.size)};
+        } else if (!DecompressImage(level.data, level.width, level.height, format, image)) {
+            return {};
+        }
+        images.push_back(std::move(image));
+    }
+    format = KTX2_FORMAT_R8G8B8A8_UNORM;
+    return TextureArray::PadLevels(images, TextureManager::LayerSize(width),
+            TextureManager::LayerSize(height));
+}
+
+// A built file older than its source, e.g. after an edit of the source during hot reload
+bool IsStale(const std::string &built, const std::string &source)
+{
+    std::error_code error;
+    auto builtTime = std::filesystem::last_write_time(built, error);
+    if (error) {
+        return false;
+    }
+    auto sourceTime = std::filesystem::last_write_time(source, error);
+    return !error && sourceTime > builtTime;
+}
+
+size_t AlignLevel(size_t size)
+{
+    return (size + STAGED_LEVEL_ALIGNMENT - 1) / STAGED_LEVEL_ALIGNMENT * STAGED_LEVEL_ALIGNMENT;
+}
+
+}
+
+AssetLoader::AssetLoader(AssetCache *cache, unsigned threads, size_t queueCapacity,
+        size_t uploadRingSize) :
+    m_cache(cache),
+    m_queueCapacity(queueCapacity),
+    m_uploadRingSize(uploadRingSize)
+{
+    if (threads == 0) {
+        threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+    for (unsigned i = 0; i < threads; ++i) {
+        m_workers.emplace_back(&AssetLoader::WorkerMain, this);
+    }
+}
+
+AssetLoader::~AssetLoader()
+{
+    Shutdown();
+}
+
+void AssetLoader::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobReady.notify_all();
+    m_uploadSpace.notify_all();
+    for (std::thread &worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+
+    // Queued uploads may hold ranges of the ring
+    m_jobs.clear();
+    m_uploads.clear();
+    m_pending = 0;
+    m_stagingRing = nullptr;
+    m_uploadRing.reset();
+    m_uploadRingSize = 0;
+}
+
+/*
+ * Takes .meshb if it has been built and the .mesh hasn't changed since.
+ * Otherwise the .mesh is parsed and optimized once and then served from
+ * the cache as .meshb.
+ */
+void AssetLoader::LoadMesh(Mesh *target, const std::string &name, bool optimize,
+        unsigned flags)
+{
+    Submit([=]() -> Upload {
+        std::shared_ptr<MeshFile> file;
+        if (!IsStale(name + ".meshb", name + ".mesh")) {
+            file = std::make_shared<MeshFile>(name + ".meshb");
+            if (file->IsOpen()) {
+                return [=]() { *target = Mesh(*file, flags); };
+            }
+        }
+
+        std::string key, cached;
+        if (m_cache) {
+            key = m_cache->MakeKey(name + ".mesh", optimize ? "mesh optimize" : "mesh");
+        }
+        if (!key.empty() && m_cache->Lookup(key, cached)) {
+            file = std::make_shared<MeshFile>(cached);
+            if (file->IsOpen()) {
+                return [=]() { *target = Mesh(*file, flags); };
+            }
+        }
+
+        auto p = std::make_shared<std::pair<std::vector<VertexN>, std::vector<GLuint>>>(
+                ReadMesh(name + ".mesh"));
+        if (optimize) {
+            OptimizeMesh(name + ".mesh", p->first, p->second);
+        }
+        if (!key.empty() && !p->first.empty()) {
+            if (MeshFile::Write(m_cache->GetTempPath(key), p->first, p->second)) {
+                m_cache->Commit(key);
+            } else {
+                m_cache->Discard(key);
+            }
+        }
+        // A failed reload keeps the mesh that is there
+        return [=]() {
+            if (!p->first.empty() || !target->IsReady()) {
+                *target = Mesh(p->first, p->second, flags);
+            }
+        };
+    });
+}
+
+/*
+ * Takes the precompressed .ktx2 next to the image if it has been built.
+ * Otherwise decoded images are cached as RGBA8 texture containers.
+ */
+void AssetLoader::LoadTexture(Texture *target, const std::string &path)
+{
+    Submit([=]() -> Upload {
+        auto compressed = std::make_shared<TextureFile>(
+                std::filesystem::path(path).replace_extension(".ktx2").string());
+        if (compressed->IsOpen()) {
+            uint32_t format = compressed->GetFormat();
+            std::vector<TextureLevel> levels = FileLevels(*compressed);
+            // Formats decoded on the CPU would read the levels back from write-combined memory
+            StagingRange range;
+            if (Texture::IsFormatSupported(format)) {
+                range = StageLevels(levels);
+            }
+            if (range) {
+                return [=]() {
+                    *target = Texture(format, levels, m_uploadRing.get());
+                    m_uploadRing->Release(range);
+                };
+            }
+            return [=]() { *target = Texture(*compressed, m_uploadRing.get()); };
+        }
+
+        auto images = std::make_shared<std::vector<Image>>(ReadTextureLevels(path));
+        std::vector<TextureLevel> levels = ImageLevels(*images);
+        StagingRange range = StageLevels(levels);
+        if (range) {
+            return [=]() {
+                *target = Texture(KTX2_FORMAT_R8G8B8A8_UNORM, levels, m_uploadRing.get());
+                m_uploadRing->Release(range);
+            };
+        }
+        return [=]() { *target = Texture(*images, m_uploadRing.get()); };
+    });
+}
+
+/*
+ * As the Texture overload, the .ktx2 next to the image is taken unless the
+ * image is newer. Padding to the layer size and hashing the source for
+ * check happen here as well.
+ */
+void AssetLoader::LoadTexture(TextureSlot *target, const std::string &path,
+        TextureManager *manager, ContentCheck check, ContentKnown known)
+{
+    ++target->loads;
+    Submit([=]() -> Upload {
+        uint64_t contentHash = 0;
+        if (check) {
+            MappedFile source(path);
+            if (source.IsOpen()) {
+                contentHash = Fnv1a(source.Data(), source.Size());
+            }
+        }
+        // A duplicate of a loaded texture: the GL thread shares it, no decode needed
+        if (known && contentHash && known(contentHash)) {
+            return [=]() {
+                --target->loads;
+                if (!check(contentHash)) {
+                    LoadTexture(target, path, manager, check);
+                }
+            };
+        }
+        auto images = std::make_shared<std::vector<Image>>();
+        uint32_t format = KTX2_FORMAT_R8G8B8A8_UNORM;
+        int width = 0, height = 0;
+        std::string built = std::filesystem::path(path).replace_extension(".ktx2").string();
+        if (!IsStale(built, path)) {
+            TextureFile file(built);
+            if (file.IsOpen() && file.GetLevelCount() > 0) {
+                width = file.GetLevel(0).width;
+                height = file.GetLevel(0).height;
+                *images = PadFileLevels(file, format);
+            }
+        }
+        if (images->empty()) {
+            format = KTX2_FORMAT_R8G8B8A8_UNORM;
+            *images = ReadTextureLevels(path);
+            if (!images->empty()) {
+                width = images->front().width;
+                height = images->front().height;
+                *images = TextureArray::PadLevels(*images, TextureManager::LayerSize(width),
+                        TextureManager::LayerSize(height));
+            }
+        }
+        // The padded levels stay in memory for streaming, the ring copy is for the first upload
+        std::vector<TextureLevel> staged = ImageLevels(*images);
+        StagingRange range = StageLevels(staged);
+        if (!range) {
+            staged.clear();
+        }
+        return [=]() {
+            --target->loads;
+            if (!check || !check(contentHash)) {
+                manager->Insert(target, images, width, height, m_uploadRing.get(), staged, format);
+            }
+            if (range) {
+                m_uploadRing->Release(range);
+            }
+        };
+    });
+}
+
+/*
+ * Worker side of texture loads: the base level and its mip chain, from the
+ * cache or decoded. Mip generation runs here so the GL thread only copies
+ * the levels. Empty on failure.
+ */
+std::vector<Image> AssetLoader::ReadTextureLevels(const std::string &path)
+{
+    std::vector<Image> images;
+    std::string key, cached;
+    if (m_cache) {
+        key = m_cache->MakeKey(path, "rgba8 flip srgb-mips");
+    }
+    if (!key.empty() && m_cache->Lookup(key, cached)) {
+        TextureFile file(cached);
+        if (file.IsOpen() && file.GetFormat() == KTX2_FORMAT_R8G8B8A8_UNORM) {
+            for (size_t i = 0; i < file.GetLevelCount(); ++i) {
+                TextureLevel level = file.GetLevel(i);
+                images.push_back({
+                    level.width, level.height,
+                    std::vector<unsigned char>(level.data, level.data + level.size)
+                });
+            }
+            return images;
+        }
+    }
+
+    images.emplace_back();
+    if (!DecodeImage(path, images.front())) {
+        images.clear();
+        return images;
+    }
+    std::vector<Image> mips = BuildMipChain(images.front());
+    std::move(mips.begin(), mips.end(), std::back_inserter(images));
+    if (!key.empty()) {
+        std::vector<TextureLevel> levels = ImageLevels(images);
+        if (TextureFile::Write(m_cache->GetTempPath(key), KTX2_FORMAT_R8G8B8A8_UNORM, levels)) {
+            m_cache->Commit(key);
+        } else {
+            m_cache->Discard(key);
+        }
+    }
+    return images;
+}
+
+/*
+ * Worker side of the upload: copies the levels into the upload ring and
+ * points them there, so the GL thread issues GL calls only. Empty if the
+ * ring isn't persistent or has no room, the levels are unchanged then.
+ */
+StagingRange AssetLoader::StageLevels(std::vector<TextureLevel> &levels)
+{
+    PixelUploadRing *ring = m_stagingRing.load();
+    if (!ring) {
+        return {};
+    }
+    size_t size = 0;
+    for (const TextureLevel &level : levels) {
+        size += AlignLevel(level.size);
+    }
+    StagingRange range = ring->Reserve(size);
+    if (!range) {
+        return range;
+    }
+    unsigned char *dst = range.data;
+    for (TextureLevel &level : levels) {
+        std::memcpy(dst, level.data, level.size);
+        level.data = dst;
+        dst += AlignLevel(level.size);
+    }
+    return range;
+}
+
+void AssetLoader::Update(double budgetSeconds)
+{
+    auto start = std::chrono::steady_clock::now();
+    if (m_uploadRingSize > 0 && !m_uploadRing) {
+        m_uploadRing = std::make_unique<PixelUploadRing>(m_uploadRingSize);
+        m_stagingRing = m_uploadRing.get();
+    }
+    if (m_uploadRing) {
+        m_uploadRing->Recycle();
+    }
+    for (;;) {
+        Upload upload;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_uploads.empty()) {
+                return;
+            }
+            upload = std::move(m_uploads.front());
+            m_uploads.pop_front();
+        }
+        m_uploadSpace.notify_one();
+
+        upload();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_pending;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() >= budgetSeconds) {
+            return;
+        }
+    }
+}
+
+size_t AssetLoader::GetPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending;
+}
+
+PixelUploadRing *AssetLoader::GetUploadRing() const
+{
+    return m_uploadRing.get();
+}
+
+void AssetLoader::PrintStats() const
+{
+    if (m_uploadRing) {
+        m_uploadRing->PrintStats();
+    }
+}
+
+void AssetLoader::Submit(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+        ++m_pending;
+    }
+    m_jobReady.notify_one();
+}
+
+void AssetLoader::WorkerMain()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobReady.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+            if (m_stopping) {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        Upload upload = job();
+
+        // Bounded: decoded payloads wait here instead of piling up in memory
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_uploadSpace.wait(lock, [this]() {
+            return m_stopping || m_uploads.size() < m_queueCapacity;
+        });
+        if (m_stopping) {
+            return;
+        }
+        m_uploads.push_back(std::move(upload));
+    }
+}
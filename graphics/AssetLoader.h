@@ -0,0 +1,94 @@
+#ifndef GRAPHICS_ASSETLOADER_H
+#define GRAPHICS_ASSETLOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AssetCache.h"
+#include "Mesh.h"
+#include "PixelUploadRing.h"
+#include "Texture.h"
+
+class TextureManager;
+struct TextureSlot;
+
+/*
+ * Loads assets in the background. Worker threads do file I/O and decoding
+ * and push upload steps into a bounded queue, which the GL thread drains
+ * in Update() within a time budget. The target Mesh/Texture stays empty
+ * (IsReady() == false) until its upload has run, and must outlive the load.
+ * Processed results go through the optional AssetCache. Texture levels
+ * are staged through a PixelUploadRing of uploadRingSize bytes (0 disables);
+ * when it is mapped persistently, workers copy the levels into it and the
+ * GL thread only issues the GL calls.
+ */
+class AssetLoader
+{
+public:
+    // threads == 0 uses all hardware threads but one
+    AssetLoader(AssetCache *cache = nullptr, unsigned threads = 0, size_t queueCapacity = 16,
+            size_t uploadRingSize = 0);
+    AssetLoader(const AssetLoader &other) = delete;
+    ~AssetLoader();
+
+    void LoadMesh(Mesh *target, const std::string &name, bool optimize = false,
+            unsigned flags = 0);
+    // GL thread, with the source's content hash (0 if unreadable). True skips the upload
+    using ContentCheck = std::function<bool(uint64_t contentHash)>;
+    // Worker threads. True if check will likely take the hash, the decode is skipped then
+    using ContentKnown = std::function<bool(uint64_t contentHash)>;
+
+    void LoadTexture(Texture *target, const std::string &path);
+    /*
+     * Into a layer of the manager's texture arrays. With check the source
+     * is hashed before decoding; if known takes the hash, check alone runs
+     * and the load starts over with a decode should it refuse.
+     */
+    void LoadTexture(TextureSlot *target, const std::string &path, TextureManager *manager,
+            ContentCheck check = nullptr, ContentKnown known = nullptr);
+
+    // GL thread, before the context goes. Stops the workers and drops unfinished loads and the ring
+    void Shutdown();
+
+    // GL thread only. Runs at least one upload if any is ready
+    void Update(double budgetSeconds);
+    // Loads requested but not uploaded yet
+    size_t GetPendingCount() const;
+    // nullptr until the first Update() or if disabled
+    PixelUploadRing *GetUploadRing() const;
+    void PrintStats() const;
+
+private:
+    using Upload = std::function<void()>;
+    using Job = std::function<Upload()>;
+
+    std::vector<Image> ReadTextureLevels(const std::string &path);
+    StagingRange StageLevels(std::vector<TextureLevel> &levels);
+    void Submit(Job job);
+    void WorkerMain();
+
+private:
+    AssetCache *                                m_cache;
+    std::vector<std::thread>                    m_workers;
+    size_t                                      m_queueCapacity;
+    size_t                                      m_uploadRingSize;
+    std::unique_ptr<PixelUploadRing>            m_uploadRing; // created on the GL thread
+    std::atomic<PixelUploadRing *>              m_stagingRing{nullptr}; // m_uploadRing for workers
+
+    mutable std::mutex                          m_mutex;
+    std::condition_variable                     m_jobReady;
+    std::condition_variable                     m_uploadSpace;
+    std::deque<Job>                             m_jobs;
+    std::deque<Upload>                          m_uploads;
+    size_t                                      m_pending = 0;
+    bool                                        m_stopping = false;
+};
+
+#endif
@@ -0,0 +1,526 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "BlockCompress.h"
+#include "TextureFile.h"
+
+namespace {
+
+struct Color
+{
+    float r, g, b;
+};
+
+uint16_t PackRGB565(const Color &c)
+{
+    int r = std::clamp(static_cast<int>(std::lround(c.r * 31.0f / 255.0f)), 0, 31);
+    int g = std::clamp(static_cast<int>(std::lround(c.g * 63.0f / 255.0f)), 0, 63);
+    int b = std::clamp(static_cast<int>(std::lround(c.b * 31.0f / 255.0f)), 0, 31);
+    return (r << 11) | (g << 5) | b;
+}
+
+void UnpackRGB565(uint16_t v, unsigned char *rgb)
+{
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// 4x4 RGBA block at (bx, by), edges are clamped
+void FetchBlock(const Image &image, int bx, int by, unsigned char block[16][4])
+{
+    for (int y = 0; y < 4; ++y) {
+        int sy = std::min(by * 4 + y, image.height - 1);
+        for (int x = 0; x < 4; ++x) {
+            int sx = std::min(bx * 4 + x, image.width - 1);
+            std::memcpy(block[y * 4 + x], &image.pixels[(size_t(sy) * image.width + sx) * 4], 4);
+        }
+    }
+}
+
+void StoreBlock(Image &image, int bx, int by, const unsigned char block[16][4])
+{
+    for (int y = 0; y < 4 && by * 4 + y < image.height; ++y) {
+        for (int x = 0; x < 4 && bx * 4 + x < image.width; ++x) {
+            size_t dst = (size_t(by * 4 + y) * image.width + bx * 4 + x) * 4;
+            std::memcpy(&image.pixels[dst], block[y * 4 + x], 4);
+        }
+    }
+}
+
+// Endpoints are the extremes of the block along its principal axis
+void EncodeColorBlock(const unsigned char block[16][4], unsigned char *out)
+{
+    Color mean = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i) {
+        mean.r += block[i][0] / 16.0f;
+        mean.g += block[i][1] / 16.0f;
+        mean.b += block[i][2] / 16.0f;
+    }
+    float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i) {
+        float r = block[i][0] - mean.r, g = block[i][1] - mean.g, b = block[i][2] - mean.b;
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+    }
+    Color axis = {1.0f, 1.0f, 1.0f};
+    for (int iter = 0; iter < 8; ++iter) {
+        Color next = {
+            cov[0] * axis.r + cov[1] * axis.g + cov[2] * axis.b,
+            cov[1] * axis.r + cov[3] * axis.g + cov[4] * axis.b,
+            cov[2] * axis.r + cov[4] * axis.g + cov[5] * axis.b
+        };
+        float len = std::max({std::abs(next.r), std::abs(next.g), std::abs(next.b)});
+        if (len == 0.0f) {
+            break;
+        }
+        axis = {next.r / len, next.g / len, next.b / len};
+    }
+
+    float lo = 1e30f, hi = -1e30f;
+    int loIdx = 0, hiIdx = 0;
+    for (int i = 0; i < 16; ++i) {
+        float t = (block[i][0] - mean.r) * axis.r + (block[i][1] - mean.g) * axis.g +
+                (block[i][2] - mean.b) * axis.b;
+        if (t < lo) {
+            lo = t;
+            loIdx = i;
+        }
+        if (t > hi) {
+            hi = t;
+            hiIdx = i;
+        }
+    }
+    uint16_t c0 = PackRGB565({float(block[hiIdx][0]), float(block[hiIdx][1]), float(block[hiIdx][2])});
+    uint16_t c1 = PackRGB565({float(block[loIdx][0]), float(block[loIdx][1]), float(block[loIdx][2])});
+    if (c0 < c1) {
+        std::swap(c0, c1);
+    }
+
+    unsigned char palette[4][3];
+    UnpackRGB565(c0, palette[0]);
+    UnpackRGB565(c1, palette[1]);
+    for (int k = 0; k < 3; ++k) {
+        palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+        palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+    }
+
+    uint32_t indices = 0;
+    if (c0 != c1) {
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestDist = 1 << 30;
+            for (int p = 0; p < 4; ++p) {
+                int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1],
+                        db = block[i][2] - palette[p][2];
+                int dist = dr * dr + dg * dg + db * db;
+                if (dist < bestDist) {
+                    best = p;
+                    bestDist = dist;
+                }
+            }
+            indices |= uint32_t(best) << (2 * i);
+        }
+    }
+    out[0] = c0 & 0xFF;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF;
+    out[3] = c1 >> 8;
+    for (int k = 0; k < 4; ++k) {
+        out[4 + k] = (indices >> (8 * k)) & 0xFF;
+    }
+}
+
+void DecodeColorBlock(const unsigned char *in, bool allowThreeColor, unsigned char block[16][4])
+{
+    uint16_t c0 = in[0] | (in[1] << 8), c1 = in[2] | (in[3] << 8);
+    unsigned char palette[4][4];
+    UnpackRGB565(c0, palette[0]);
+    UnpackRGB565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+    if (c0 > c1 || !allowThreeColor) {
+        for (int k = 0; k < 3; ++k) {
+            palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+            palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+        }
+    } else {
+        for (int k = 0; k < 3; ++k) {
+            palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+            palette[3][k] = 0;
+        }
+        palette[3][3] = 0;
+    }
+    uint32_t indices = in[4] | (in[5] << 8) | (in[6] << 16) | (uint32_t(in[7]) << 24);
+    for (int i = 0; i < 16; ++i) {
+        std::memcpy(block[i], palette[(indices >> (2 * i)) & 3], 4);
+    }
+}
+
+void AlphaPalette(unsigned char a0, unsigned char a1, unsigned char palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i < 7; ++i) {
+            palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        }
+    } else {
+        for (int i = 1; i < 5; ++i) {
+            palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+void EncodeAlphaBlock(const unsigned char block[16][4], unsigned char *out)
+{
+    unsigned char a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; ++i) {
+        a0 = std::max(a0, block[i][3]);
+        a1 = std::min(a1, block[i][3]);
+    }
+    unsigned char palette[8];
+    AlphaPalette(a0, a1, palette);
+    uint64_t indices = 0;
+    if (a0 != a1) {
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestDist = 256;
+            for (int p = 0; p < 8; ++p) {
+                int dist = std::abs(block[i][3] - palette[p]);
+                if (dist < bestDist) {
+                    best = p;
+                    bestDist = dist;
+                }
+            }
+            indices |= uint64_t(best) << (3 * i);
+        }
+    }
+    out[0] = a0;
+    out[1] = a1;
+    for (int k = 0; k < 6; ++k) {
+        out[2 + k] = (indices >> (8 * k)) & 0xFF;
+    }
+}
+
+void DecodeAlphaBlock(const unsigned char *in, unsigned char block[16][4])
+{
+    unsigned char palette[8];
+    AlphaPalette(in[0], in[1], palette);
+    uint64_t indices = 0;
+    for (int k = 0; k < 6; ++k) {
+        indices |= uint64_t(in[2 + k]) << (8 * k);
+    }
+    for (int i = 0; i < 16; ++i) {
+        block[i][3] = palette[(indices >> (3 * i)) & 7];
+    }
+}
+
+// BC7 mode 6: one subset, RGBA endpoints of 7 bits plus a p-bit each, 4-bit indices
+const int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+const int BC7_REFINE_STEPS = 4;
+
+void PutBits(unsigned char *out, int &pos, uint32_t value, int count)
+{
+    for (int i = 0; i < count; ++i, ++pos) {
+        out[pos / 8] |= ((value >> i) & 1) << (pos % 8);
+    }
+}
+
+uint32_t GetBits(const unsigned char *in, int &pos, int count)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < count; ++i, ++pos) {
+        value |= uint32_t((in[pos / 8] >> (pos % 8)) & 1) << i;
+    }
+    return value;
+}
+
+void Bc7Palette(const unsigned char endpoints[2][4], unsigned char palette[16][4])
+{
+    for (int p = 0; p < 16; ++p) {
+        for (int k = 0; k < 4; ++k) {
+            palette[p][k] = ((64 - BC7_WEIGHTS[p]) * endpoints[0][k] +
+                    BC7_WEIGHTS[p] * endpoints[1][k] + 32) >> 6;
+        }
+    }
+}
+
+// Endpoint as 7-bit channels and the p-bit that together come closest to it
+void QuantizeBc7Endpoint(const float color[4], unsigned char quantized[4], int &pbit)
+{
+    float bestError = 1e30f;
+    for (int p = 0; p < 2; ++p) {
+        unsigned char q[4];
+        float error = 0.0f;
+        for (int k = 0; k < 4; ++k) {
+            q[k] = std::clamp(static_cast<int>(std::lround((color[k] - p) / 2.0f)), 0, 127);
+            float d = color[k] - ((q[k] << 1) | p);
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            pbit = p;
+            std::memcpy(quantized, q, 4);
+        }
+    }
+}
+
+// Quantizes the endpoints and picks the nearest palette entry per pixel. Returns the squared error
+int FitBc7Indices(const unsigned char block[16][4], const float ends[2][4],
+        unsigned char quantized[2][4], int pbits[2], int indices[16])
+{
+    unsigned char endpoints[2][4];
+    for (int e = 0; e < 2; ++e) {
+        QuantizeBc7Endpoint(ends[e], quantized[e], pbits[e]);
+        for (int k = 0; k < 4; ++k) {
+            endpoints[e][k] = (quantized[e][k] << 1) | pbits[e];
+        }
+    }
+    unsigned char palette[16][4];
+    Bc7Palette(endpoints, palette);
+    int error = 0;
+    for (int i = 0; i < 16; ++i) {
+        int bestDist = 1 << 30;
+        for (int p = 0; p < 16; ++p) {
+            int dist = 0;
+            for (int k = 0; k < 4; ++k) {
+                int d = block[i][k] - palette[p][k];
+                dist += d * d;
+            }
+            if (dist < bestDist) {
+                indices[i] = p;
+                bestDist = dist;
+            }
+        }
+        error += bestDist;
+    }
+    return error;
+}
+
+// Endpoints minimizing the squared error for fixed indices. False if they are not determined
+bool RefineBc7Endpoints(const unsigned char block[16][4], const int indices[16],
+        float ends[2][4])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; ++i) {
+        float w = BC7_WEIGHTS[indices[i]] / 64.0f;
+        aa += (1.0f - w) * (1.0f - w);
+        ab += (1.0f - w) * w;
+        bb += w * w;
+        for (int k = 0; k < 4; ++k) {
+            ax[k] += (1.0f - w) * block[i][k];
+            bx[k] += w * block[i][k];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::abs(det) < 1e-6f) {
+        return false;
+    }
+    for (int k = 0; k < 4; ++k) {
+        ends[0][k] = std::clamp((bb * ax[k] - ab * bx[k]) / det, 0.0f, 255.0f);
+        ends[1][k] = std::clamp((aa * bx[k] - ab * ax[k]) / det, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+// Endpoints start at the extremes of the block along its principal RGBA axis
+void EncodeBc7Block(const unsigned char block[16][4], unsigned char *out)
+{
+    float mean[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i) {
+        for (int k = 0; k < 4; ++k) {
+            mean[k] += block[i][k] / 16.0f;
+        }
+    }
+    float cov[4][4] = {};
+    for (int i = 0; i < 16; ++i) {
+        for (int a = 0; a < 4; ++a) {
+            for (int b = 0; b < 4; ++b) {
+                cov[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+            }
+        }
+    }
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (int iter = 0; iter < 8; ++iter) {
+        float next[4] = {};
+        float len = 0.0f;
+        for (int a = 0; a < 4; ++a) {
+            for (int b = 0; b < 4; ++b) {
+                next[a] += cov[a][b] * axis[b];
+            }
+            len = std::max(len, std::abs(next[a]));
+        }
+        if (len == 0.0f) {
+            break;
+        }
+        for (int a = 0; a < 4; ++a) {
+            axis[a] = next[a] / len;
+        }
+    }
+
+    float lo = 1e30f, hi = -1e30f;
+    for (int i = 0; i < 16; ++i) {
+        float t = 0.0f;
+        for (int k = 0; k < 4; ++k) {
+            t += (block[i][k] - mean[k]) * axis[k];
+        }
+        lo = std::min(lo, t);
+        hi = std::max(hi, t);
+    }
+    float axisLength = 0.0f;
+    for (int k = 0; k < 4; ++k) {
+        axisLength += axis[k] * axis[k];
+    }
+    float ends[2][4];
+    for (int k = 0; k < 4; ++k) {
+        float scale = axisLength > 0.0f ? axis[k] / axisLength : 0.0f;
+        ends[0][k] = std::clamp(mean[k] + lo * scale, 0.0f, 255.0f);
+        ends[1][k] = std::clamp(mean[k] + hi * scale, 0.0f, 255.0f);
+    }
+
+    // Then refined by least squares over the chosen indices, the best try is kept
+    unsigned char quantized[2][4];
+    int pbits[2], indices[16];
+    int bestError = -1;
+    for (int iter = 0; iter < BC7_REFINE_STEPS; ++iter) {
+        unsigned char tryQuantized[2][4];
+        int tryPbits[2], tryIndices[16];
+        int error = FitBc7Indices(block, ends, tryQuantized, tryPbits, tryIndices);
+        if (bestError < 0 || error < bestError) {
+            bestError = error;
+            std::memcpy(quantized, tryQuantized, sizeof(quantized));
+            std::memcpy(pbits, tryPbits, sizeof(pbits));
+            std::memcpy(indices, tryIndices, sizeof(indices));
+        }
+        if (error == 0 || !RefineBc7Endpoints(block, tryIndices, ends)) {
+            break;
+        }
+    }
+    // The first index is stored without its top bit, which must be 0
+    if (indices[0] & 8) {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pbits[0], pbits[1]);
+        for (int &index : indices) {
+            index = 15 - index;
+        }
+    }
+
+    std::memset(out, 0, 16);
+    int pos = 0;
+    PutBits(out, pos, 1 << 6, 7);
+    for (int k = 0; k < 4; ++k) {
+        PutBits(out, pos, quantized[0][k], 7);
+        PutBits(out, pos, quantized[1][k], 7);
+    }
+    PutBits(out, pos, pbits[0], 1);
+    PutBits(out, pos, pbits[1], 1);
+    for (int i = 0; i < 16; ++i) {
+        PutBits(out, pos, indices[i], i == 0 ? 3 : 4);
+    }
+}
+
+// Mode 6 only, false for blocks in any other mode
+bool DecodeBc7Block(const unsigned char *in, unsigned char block[16][4])
+{
+    int pos = 0;
+    if (GetBits(in, pos, 7) != 1 << 6) {
+        return false;
+    }
+    unsigned char endpoints[2][4];
+    for (int k = 0; k < 4; ++k) {
+        endpoints[0][k] = GetBits(in, pos, 7) << 1;
+        endpoints[1][k] = GetBits(in, pos, 7) << 1;
+    }
+    for (int e = 0; e < 2; ++e) {
+        uint32_t pbit = GetBits(in, pos, 1);
+        for (int k = 0; k < 4; ++k) {
+            endpoints[e][k] |= pbit;
+        }
+    }
+    unsigned char palette[16][4];
+    Bc7Palette(endpoints, palette);
+    for (int i = 0; i < 16; ++i) {
+        std::memcpy(block[i], palette[GetBits(in, pos, i == 0 ? 3 : 4)], 4);
+    }
+    return true;
+}
+
+size_t BlockBytes(uint32_t format)
+{
+    return format == KTX2_FORMAT_BC1_RGBA_UNORM ? 8 : 16;
+}
+
+}
+
+bool IsBlockCompressed(uint32_t format)
+{
+    return format == KTX2_FORMAT_BC1_RGBA_UNORM || format == KTX2_FORMAT_BC3_UNORM ||
+            format == KTX2_FORMAT_BC7_UNORM;
+}
+
+size_t CompressedSize(int width, int height, uint32_t format)
+{
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+std::vector<unsigned char> CompressImage(const Image &image, uint32_t format)
+{
+    std::vector<unsigned char> result(CompressedSize(image.width, image.height, format));
+    unsigned char *out = result.data();
+    unsigned char block[16][4];
+    for (int by = 0; by < (image.height + 3) / 4; ++by) {
+        for (int bx = 0; bx < (image.width + 3) / 4; ++bx) {
+            FetchBlock(image, bx, by, block);
+            if (format == KTX2_FORMAT_BC7_UNORM) {
+                EncodeBc7Block(block, out);
+                out += 16;
+                continue;
+            }
+            if (format == KTX2_FORMAT_BC3_UNORM) {
+                EncodeAlphaBlock(block, out);
+                out += 8;
+            }
+            EncodeColorBlock(block, out);
+            out += 8;
+        }
+    }
+    return result;
+}
+
+bool DecompressImage(const unsigned char *data, int width, int height, uint32_t format,
+        Image &image)
+{
+    if (!IsBlockCompressed(format)) {
+        return false;
+    }
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(size_t(width) * height * 4);
+    unsigned char block[16][4];
+    for (int by = 0; by < (height + 3) / 4; ++by) {
+        for (int bx = 0; bx < (width + 3) / 4; ++bx) {
+            if (format == KTX2_FORMAT_BC7_UNORM) {
+                if (!DecodeBc7Block(data, block)) {
+                    return false;
+                }
+                data += 16;
+            } else if (format == KTX2_FORMAT_BC3_UNORM) {
+                DecodeColorBlock(data + 8, false, block);
+                DecodeAlphaBlock(data, block);
+                data += 16;
+            } else {
+                DecodeColorBlock(data, true, block);
+                data += 8;
+            }
+            StoreBlock(image, bx, by, block);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,24 @@
+#ifndef GRAPHICS_BLOCKCOMPRESS_H
+#define GRAPHICS_BLOCKCOMPRESS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Image.h"
+
+/*
+ * BC1, BC3 and BC7 block compression of RGBA8 images and the matching CPU
+ * decoders, used when the driver can't sample a compressed format. BC7 is
+ * encoded in mode 6 only, and only mode 6 blocks decode on the CPU.
+ * Formats are KTX2 vkFormat values.
+ */
+bool IsBlockCompressed(uint32_t format);
+size_t CompressedSize(int width, int height, uint32_t format);
+
+std::vector<unsigned char> CompressImage(const Image &image, uint32_t format);
+// False for formats without a CPU decoder and for BC7 blocks in modes other than 6
+bool DecompressImage(const unsigned char *data, int width, int height, uint32_t format,
+        Image &image);
+
+#endif
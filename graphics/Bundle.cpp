@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "Bundle.h"
+#include "Hash.h"
+#include "MappedFile.h"
+
+namespace {
+
+const char BUNDLE_MAGIC[4] = {'M', 'G', 'P', 'K'};
+
+MappedFile                                      s_file;
+const BundleEntry *                             s_entries = nullptr;
+uint32_t                                        s_entryCount = 0;
+const char *                                    s_names = nullptr;
+
+uint64_t AlignUp(uint64_t offset)
+{
+    return (offset + BUNDLE_ALIGNMENT - 1) & ~uint64_t(BUNDLE_ALIGNMENT - 1);
+}
+
+}
+
+bool Bundle::Mount(const std::string &path)
+{
+    Unmount();
+    MappedFile file(path, false);
+    if (!file.IsOpen()) {
+        return false;
+    }
+    BundleHeader h;
+    if (file.Size() < sizeof(h)) {
+        std::cerr << "Bundle is too small: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(&h, file.Data(), sizeof(h));
+    if (std::memcmp(h.magic, BUNDLE_MAGIC, sizeof(h.magic)) != 0 || h.version != BUNDLE_VERSION ||
+            h.tableOffset % alignof(BundleEntry) ||
+            h.tableOffset > file.Size() ||
+            uint64_t(h.entryCount) * sizeof(BundleEntry) > file.Size() - h.tableOffset) {
+        std::cerr << "Invalid bundle: " << path << std::endl;
+        return false;
+    }
+    const BundleEntry *entries = reinterpret_cast<const BundleEntry *>(file.Data() + h.tableOffset);
+    uint64_t namesOffset = h.tableOffset + uint64_t(h.entryCount) * sizeof(BundleEntry);
+    uint64_t namesSize = file.Size() - namesOffset;
+    for (uint32_t i = 0; i < h.entryCount; ++i) {
+        const BundleEntry &e = entries[i];
+        if (e.offset > file.Size() || e.size > file.Size() - e.offset ||
+                e.nameOffset > namesSize || e.nameLength > namesSize - e.nameOffset) {
+            std::cerr << "Corrupted bundle: " << path << std::endl;
+            return false;
+        }
+    }
+
+    s_file = std::move(file);
+    s_entries = entries;
+    s_entryCount = h.entryCount;
+    s_names = reinterpret_cast<const char *>(s_file.Data() + namesOffset);
+    std::cout << "Mounted bundle " << path << ": " << s_entryCount << " files" << std::endl;
+    return true;
+}
+
+void Bundle::Unmount()
+{
+    s_file = MappedFile();
+    s_entries = nullptr;
+    s_entryCount = 0;
+    s_names = nullptr;
+}
+
+bool Bundle::IsMounted()
+{
+    return s_entries != nullptr;
+}
+
+bool Bundle::Find(const std::string &path, const unsigned char *&data, size_t &size)
+{
+    if (!s_entries) {
+        return false;
+    }
+    std::string name = NormalizeName(path);
+    uint64_t hash = HashName(name);
+    const BundleEntry *end = s_entries + s_entryCount;
+    const BundleEntry *it = std::lower_bound(s_entries, end, hash,
+            [](const BundleEntry &e, uint64_t h) { return e.nameHash < h; });
+    // Hashes are unique within a bundle, but a missing path can still collide
+    if (it == end || it->nameHash != hash || it->nameLength != name.size() ||
+            std::memcmp(s_names + it->nameOffset, name.data(), name.size()) != 0) {
+        return false;
+    }
+    data = s_file.Data() + it->offset;
+    size = it->size;
+    return true;
+}
+
+bool Bundle::Write(const std::string &path, const std::vector<std::string> &files)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Could not create bundle: " << path << std::endl;
+        return false;
+    }
+
+    BundleHeader h = {};
+    std::memcpy(h.magic, BUNDLE_MAGIC, sizeof(h.magic));
+    h.version = BUNDLE_VERSION;
+    h.entryCount = files.size();
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+
+    static const char padding[BUNDLE_ALIGNMENT] = {};
+    std::vector<BundleEntry> entries;
+    std::string names;
+    uint64_t offset = sizeof(h);
+    for (const std::string &name : files) {
+        MappedFile file(name, false);
+        if (!file.IsOpen()) {
+            std::cerr << "Could not read " << name << std::endl;
+            return false;
+        }
+        uint64_t aligned = AlignUp(offset);
+        out.write(padding, aligned - offset);
+        out.write(reinterpret_cast<const char *>(file.Data()), file.Size());
+        std::string normalized = NormalizeName(name);
+        entries.push_back({HashName(normalized), aligned, file.Size(),
+                static_cast<uint32_t>(names.size()), static_cast<uint32_t>(normalized.size())});
+        names += normalized;
+        offset = aligned + file.Size();
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const BundleEntry &a, const BundleEntry &b) {
+        return a.nameHash < b.nameHash;
+    });
+    for (size_t i = 1; i < entries.size(); ++i) {
+        if (entries[i].nameHash == entries[i - 1].nameHash) {
+            std::cerr << "Duplicate or colliding file names in bundle" << std::endl;
+            return false;
+        }
+    }
+
+    h.tableOffset = AlignUp(offset);
+    out.write(padding, h.tableOffset - offset);
+    out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(BundleEntry));
+    out.write(names.data(), names.size());
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    if (!out) {
+        std::cerr << "Failed to write bundle: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// "./res//cube.mesh" and "res/cube.mesh" name the same entry
+std::string Bundle::NormalizeName(const std::string &path)
+{
+    return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+uint64_t Bundle::HashName(const std::string &name)
+{
+    return Fnv1a(name.data(), name.size());
+}
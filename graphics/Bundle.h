@@ -0,0 +1,56 @@
+#ifndef GRAPHICS_BUNDLE_H
+#define GRAPHICS_BUNDLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Asset bundle (.pak): BundleHeader, payloads aligned to
+ * BUNDLE_ALIGNMENT, then a table of BundleEntry sorted by name hash and
+ * the normalized names the entries point into. Once mounted, MappedFile
+ * serves any path found in the bundle straight from the single mapping
+ * of the bundle.
+ */
+enum {
+    BUNDLE_VERSION = 2,
+    BUNDLE_ALIGNMENT = 16
+};
+
+struct BundleHeader
+{
+    char                                        magic[4];       // "MGPK"
+    uint32_t                                    version;
+    uint32_t                                    entryCount;
+    uint32_t                                    reserved;
+    uint64_t                                    tableOffset;
+};
+
+struct BundleEntry
+{
+    uint64_t                                    nameHash;
+    uint64_t                                    offset;
+    uint64_t                                    size;
+    uint32_t                                    nameOffset;     // into the name table
+    uint32_t                                    nameLength;
+};
+
+class Bundle
+{
+public:
+    static bool Mount(const std::string &path);
+    static void Unmount();
+    static bool IsMounted();
+
+    // Looks up a path relative to the working directory
+    static bool Find(const std::string &path, const unsigned char *&data, size_t &size);
+
+    static bool Write(const std::string &path, const std::vector<std::string> &files);
+
+private:
+    static std::string NormalizeName(const std::string &path);
+    static uint64_t HashName(const std::string &name);
+};
+
+#endif
@@ -2,9 +2,11 @@
 #include "../App.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
-Entity::Entity(Mesh *mesh, Shader *shader, Texture *texture) :
+Entity::Entity(Mesh *mesh, Shader *shader, const TextureSlot *texture) :
     m_mesh(mesh),
     m_shader(shader),
     m_texture(texture)
@@ -15,29 +17,81 @@ void Entity::Update()
 {
 }
 
+glm::mat4 Entity::GetModelTransform() const
+{
+    glm::mat4 t(1.0);
+    t = glm::translate(t, m_position);
+    t = glm::scale(t, m_scale);
+    t = glm::rotate(t, m_angle, m_rotAxis);
+    return t;
+}
+
 void Entity::Draw(const glm::mat4 &pv) const
 {
     if (!m_mesh || !m_shader) {
         std::cerr << "Error: drawing without mesh or shader!" << std::endl;
         return;
     }
-    glm::mat4 t(1.0);
-    t = glm::translate(t, m_position);
-    t = glm::scale(t, m_scale);
-    t = glm::rotate(t, m_angle, m_rotAxis);
+    if (!m_shader->IsReady()) {
+        return;
+    }
+    CheckAttributes();
+    glm::mat4 t = GetModelTransform();
     if (m_shader == &App::app->m_shaders[App::SHADER_LIGHTING]) {
-        m_shader->SetUniform("modelTransform", t);
-        if (m_texture) {
-            m_shader->SetUniform("basicColor", glm::vec3(0.0, 0.0, 0.0));
-        } else {
-            m_shader->SetUniform("basicColor", m_basicColor);
+        m_shader->SetUniform(UNIFORM_MODEL_TRANSFORM, t);
+        // Only the material block changes between entities sharing a texture array
+        if (m_texture && m_texture->IsReady()) {
+            m_texture->array->Bind();
+            // Meshes span [-1, 1] in object space
+            float radius = std::sqrt(3.0f) * std::max({m_scale.x, m_scale.y, m_scale.z});
+            App::app->m_textureStreamer.Request(m_texture, m_position, radius);
         }
+        m_shader->SetUniform(UNIFORM_OCT_NORMALS, m_mesh->IsPacked() ? 1 : 0);
     }
 
-    m_shader->SetUniform("fullTransform", pv * t);
+    m_shader->SetUniform(UNIFORM_FULL_TRANSFORM, pv * t);
+    m_shader->SetUniform(UNIFORM_POS_SCALE, m_mesh->GetPosScale());
+    m_shader->SetUniform(UNIFORM_POS_OFFSET, m_mesh->GetPosOffset());
     m_shader->Use();
-    if (m_texture) {
-        m_texture->Bind();
-    }
     m_mesh->Draw();
 }
+
+void Entity::DrawDepth(Shader *shader, const glm::mat4 &pv) const
+{
+    if (!m_mesh) {
+        std::cerr << "Error: drawing without mesh!" << std::endl;
+        return;
+    }
+    if (!shader->IsReady()) {
+        return;
+    }
+    shader->SetUniform(UNIFORM_FULL_TRANSFORM, pv * GetModelTransform());
+    shader->SetUniform(UNIFORM_POS_SCALE, m_mesh->GetPosScale());
+    shader->SetUniform(UNIFORM_POS_OFFSET, m_mesh->GetPosOffset());
+    shader->Use();
+    m_mesh->DrawDepth();
+}
+
+void Entity::CheckAttributes() const
+{
+    if (m_attribsChecked || !m_mesh->IsReady() || !m_shader->IsReady()) {
+        return;
+    }
+    m_attribsChecked = true;
+    if (m_shader->GetAttribMask() & ~m_mesh->GetAttribMask()) {
+        std::cerr << "Warning: mesh does not provide every attribute the shader reads" <<
+                std::endl;
+    }
+}
+
+MaterialBlock Entity::GetMaterial() const
+{
+    MaterialBlock material = {};
+    material.basicColor = m_basicColor;
+    material.textureLayer = -1;
+    if (m_texture && m_texture->IsReady()) {
+        material.uvTransform = m_texture->uvTransform;
+        material.textureLayer = m_texture->layer;
+    }
+    return material;
+}
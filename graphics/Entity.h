@@ -2,19 +2,29 @@
 #define GRAPHICS_ENTITY_H
 
 #include "Shader.h"
-#include "Texture.h"
+#include "TextureManager.h"
 #include "Mesh.h"
+#include "UniformBlocks.h"
 
 #include <glm/glm.hpp>
 
 class Entity
 {
 public:
-    Entity(Mesh *mesh = nullptr, Shader *shader = nullptr, Texture *texture = nullptr);
+    Entity(Mesh *mesh = nullptr, Shader *shader = nullptr, const TextureSlot *texture = nullptr);
     virtual ~Entity() = default;
 
     void Update();
+    // Lighting shader: the caller binds the block from GetMaterial first
     void Draw(const glm::mat4 &pv) const;
+    // Depth-only pass: positions only, with the given shader
+    void DrawDepth(Shader *shader, const glm::mat4 &pv) const;
+    MaterialBlock GetMaterial() const;
+
+private:
+    glm::mat4 GetModelTransform() const;
+    // Warns once, as soon as both the mesh upload and the shader build have finished
+    void CheckAttributes() const;
 
 public:
     float                                           m_angle = 0.0;
@@ -26,7 +36,10 @@ public:
 
     Mesh *                                          m_mesh;
     Shader *                                        m_shader;
-    Texture *                                       m_texture;
+    const TextureSlot *                             m_texture;
+
+private:
+    mutable bool                                    m_attribsChecked = false;
 };
 
 #endif
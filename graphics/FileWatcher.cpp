@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "FileWatcher.h"
+
+FileWatcher::FileWatcher()
+{
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        std::cerr << "inotify_init1 failed: " << std::strerror(errno) << std::endl;
+    }
+}
+
+FileWatcher::~FileWatcher()
+{
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+// Editors either rewrite a file in place or rename a temporary over it
+bool FileWatcher::Watch(const std::string &directory)
+{
+    if (m_fd < 0) {
+        return false;
+    }
+    int wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+        std::cerr << "Cannot watch " << directory << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    m_directories[wd] = directory;
+    return true;
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+    std::vector<std::string> changed;
+    if (m_fd < 0) {
+        return changed;
+    }
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t length = read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (char *p = buffer; p < buffer + length; ) {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(p);
+            p += sizeof(inotify_event) + event->len;
+            auto directory = m_directories.find(event->wd);
+            if (event->len == 0 || directory == m_directories.end()) {
+                continue;
+            }
+            std::string path = directory->second + "/" + event->name;
+            if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+                changed.push_back(path);
+            }
+        }
+    }
+    return changed;
+}
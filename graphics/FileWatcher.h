@@ -0,0 +1,29 @@
+#ifndef GRAPHICS_FILEWATCHER_H
+#define GRAPHICS_FILEWATCHER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Reports files written or moved into watched directories, using inotify.
+ * Poll() never blocks, so it can run once per frame.
+ */
+class FileWatcher
+{
+public:
+    FileWatcher();
+    FileWatcher(const FileWatcher &other) = delete;
+    ~FileWatcher();
+
+    // Not recursive
+    bool Watch(const std::string &directory);
+    // Paths as "<directory>/<name>", each changed file once
+    std::vector<std::string> Poll();
+
+private:
+    int                                         m_fd = -1;
+    std::unordered_map<int, std::string>        m_directories; // by watch descriptor
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <map>
+#include <utility>
+
+#include "GpuTracker.h"
+
+namespace {
+
+struct Allocation
+{
+    GpuCategory                                 category;
+    size_t                                      size;
+    const char *                                tag;
+    const char *                                file;
+    int                                         line;
+};
+
+const char *CATEGORY_NAMES[GPU_CATEGORY_LAST] = {"mesh", "texture", "framebuffer", "staging"};
+const char *OBJECT_NAMES[] = {"buffer", "vertex array", "texture", "framebuffer"};
+
+struct State
+{
+    std::map<std::pair<GpuObject, GLuint>, Allocation> allocations;
+    size_t                                      totals[GPU_CATEGORY_LAST] = {};
+    size_t                                      total = 0;
+    size_t                                      peak = 0;
+    size_t                                      budget = 0;
+};
+
+State &GetState()
+{
+    static State state;
+    return state;
+}
+
+// Once per crossing, not on every allocation past it
+void CheckBudget(State &state, size_t before)
+{
+    if (state.budget == 0 || before > state.budget || state.total <= state.budget) {
+        return;
+    }
+    std::cerr << "Warning: GPU memory " << state.total / 1024 << " KiB exceeds the budget of " <<
+            state.budget / 1024 << " KiB" << std::endl;
+    GpuTracker::PrintStats();
+}
+
+}
+
+void GpuTracker::Track(GpuObject object, GLuint id, GpuCategory category, size_t size,
+        const char *tag, const char *file, int line)
+{
+    State &state = GetState();
+    auto key = std::make_pair(object, id);
+    if (state.allocations.count(key)) {
+        std::cerr << "GPU " << OBJECT_NAMES[object] << " " << id << " tracked twice (" << tag <<
+                ", " << file << ":" << line << ")" << std::endl;
+        Untrack(object, id);
+    }
+    state.allocations[key] = {category, size, tag, file, line};
+    size_t before = state.total;
+    state.totals[category] += size;
+    state.total += size;
+    state.peak = std::max(state.peak, state.total);
+    CheckBudget(state, before);
+}
+
+void GpuTracker::Resize(GpuObject object, GLuint id, size_t size)
+{
+    State &state = GetState();
+    auto it = state.allocations.find(std::make_pair(object, id));
+    if (it == state.allocations.end()) {
+        return;
+    }
+    size_t before = state.total;
+    state.totals[it->second.category] += size - it->second.size;
+    state.total += size - it->second.size;
+    it->second.size = size;
+    state.peak = std::max(state.peak, state.total);
+    CheckBudget(state, before);
+}
+
+void GpuTracker::Untrack(GpuObject object, GLuint id)
+{
+    State &state = GetState();
+    auto it = state.allocations.find(std::make_pair(object, id));
+    if (it == state.allocations.end()) {
+        return;
+    }
+    state.totals[it->second.category] -= it->second.size;
+    state.total -= it->second.size;
+    state.allocations.erase(it);
+}
+
+size_t GpuTracker::GetTotal(GpuCategory category)
+{
+    return GetState().totals[category];
+}
+
+size_t GpuTracker::GetTotal()
+{
+    return GetState().total;
+}
+
+size_t GpuTracker::GetObjectCount()
+{
+    return GetState().allocations.size();
+}
+
+void GpuTracker::SetBudget(size_t budget)
+{
+    GetState().budget = budget;
+}
+
+void GpuTracker::PrintStats()
+{
+    const State &state = GetState();
+    std::cout << "GPU memory: " << state.total / 1024 << " KiB in " <<
+            state.allocations.size() << " objects (peak " << state.peak / 1024 << " KiB)";
+    for (int i = 0; i < GPU_CATEGORY_LAST; ++i) {
+        std::cout << ", " << CATEGORY_NAMES[i] << " " << state.totals[i] / 1024 << " KiB";
+    }
+    std::cout << std::endl;
+}
+
+size_t GpuTracker::ReportLeaks()
+{
+    const State &state = GetState();
+    for (const auto &entry : state.allocations) {
+        const Allocation &allocation = entry.second;
+        std::cerr << "Leaked GPU " << OBJECT_NAMES[entry.first.first] << " " <<
+                entry.first.second << ": " << allocation.tag << ", " << allocation.size <<
+                " bytes, created at " << allocation.file << ":" << allocation.line << std::endl;
+    }
+    return state.allocations.size();
+}
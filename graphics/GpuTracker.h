@@ -0,0 +1,52 @@
+#ifndef GRAPHICS_GPUTRACKER_H
+#define GRAPHICS_GPUTRACKER_H
+
+#include <GL/glew.h>
+#include <cstddef>
+
+enum GpuCategory {
+    GPU_MESH = 0,
+    GPU_TEXTURE,
+    GPU_FRAMEBUFFER,
+    GPU_STAGING,
+    GPU_CATEGORY_LAST
+};
+
+// GL object namespaces, names are only unique within one
+enum GpuObject {
+    GPU_OBJECT_BUFFER = 0,
+    GPU_OBJECT_VERTEX_ARRAY,
+    GPU_OBJECT_TEXTURE,
+    GPU_OBJECT_FRAMEBUFFER
+};
+
+/*
+ * Records every GL object the engine creates with its estimated size,
+ * an owner tag and the creation site. Keeps live totals per category,
+ * warns when the total crosses the budget and lists the objects never
+ * deleted. GL thread only.
+ */
+class GpuTracker
+{
+public:
+    static void Track(GpuObject object, GLuint id, GpuCategory category, size_t size,
+            const char *tag, const char *file, int line);
+    // Storage of a tracked object changed
+    static void Resize(GpuObject object, GLuint id, size_t size);
+    static void Untrack(GpuObject object, GLuint id);
+
+    static size_t GetTotal(GpuCategory category);
+    static size_t GetTotal();
+    static size_t GetObjectCount();
+    // 0 disables the warning
+    static void SetBudget(size_t budget);
+
+    static void PrintStats();
+    // Objects still alive, meant for shutdown. Returns their count
+    static size_t ReportLeaks();
+};
+
+#define GPU_TRACK(object, id, category, size, tag) \
+    GpuTracker::Track(object, id, category, size, tag, __FILE__, __LINE__)
+
+#endif
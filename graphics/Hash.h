@@ -0,0 +1,19 @@
+#ifndef GRAPHICS_HASH_H
+#define GRAPHICS_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+const uint64_t FNV1A_BASIS = 14695981039346656037ull;
+
+// 64-bit FNV-1a, pass the previous result as h to hash several blocks
+inline uint64_t Fnv1a(const void *data, size_t size, uint64_t h = FNV1A_BASIS)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ p[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+#endif
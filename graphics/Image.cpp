@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "Image.h"
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+
+bool DecodeImage(const std::string &path, Image &image, const ImageDecoder *decoder)
+{
+    MappedFile file(path);
+    bool decoded = false;
+    if (file.IsOpen()) {
+        if (decoder) {
+            decoded = decoder->Decode(file.Data(), file.Size(), image);
+        } else {
+            for (const ImageDecoder *candidate : ImageDecoder::GetDecoders()) {
+                if (candidate->CanDecode(file.Data(), file.Size())) {
+                    decoded = candidate->Decode(file.Data(), file.Size(), image);
+                    break;
+                }
+            }
+        }
+    }
+    if (!decoded) {
+        std::cerr << "Failed to load image: " << path << std::endl;
+        image = Image();
+        return false;
+    }
+    return true;
+}
+
+// Threads take the next path from a shared counter, so uneven sizes balance out
+size_t DecodeImages(const std::vector<std::string> &paths, std::vector<Image> &images,
+        unsigned threads, const ImageDecoder *decoder)
+{
+    images.assign(paths.size(), Image());
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min<size_t>(threads, paths.size());
+
+    std::atomic<size_t> next{0}, decoded{0};
+    auto work = [&]() {
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            if (DecodeImage(paths[i], images[i], decoder)) {
+                ++decoded;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    return decoded;
+}
@@ -0,0 +1,23 @@
+#ifndef GRAPHICS_IMAGE_H
+#define GRAPHICS_IMAGE_H
+
+#include <string>
+#include <vector>
+
+// Decoded RGBA8 image, bottom row first
+struct Image
+{
+    int                                         width = 0;
+    int                                         height = 0;
+    std::vector<unsigned char>                  pixels;
+};
+
+class ImageDecoder;
+
+// Safe to call from any thread. Without a decoder the first one accepting the file is used
+bool DecodeImage(const std::string &path, Image &image, const ImageDecoder *decoder = nullptr);
+// Decodes on up to threads threads (0: all cores). Returns the number decoded
+size_t DecodeImages(const std::vector<std::string> &paths, std::vector<Image> &images,
+        unsigned threads = 0, const ImageDecoder *decoder = nullptr);
+
+#endif
@@ -0,0 +1,112 @@
+#include <cstring>
+#include <mutex>
+
+#define STB_IMAGE_IMPLEMENTATION
+#pragma GCC diagnostic ignored "-Wtype-limits"
+#include "../deps/stb_image.h"
+#pragma GCC diagnostic pop
+
+#ifdef HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+#include "ImageDecoder.h"
+
+namespace {
+
+class StbDecoder : public ImageDecoder
+{
+public:
+    const char *GetName() const override
+    {
+        return "stb";
+    }
+
+    bool CanDecode(const unsigned char *, size_t) const override
+    {
+        return true;
+    }
+
+    bool Decode(const unsigned char *data, size_t size, Image &image) const override
+    {
+        // stb keeps the flag in a global, set it once before any thread decodes
+        static std::once_flag flipFlag;
+        std::call_once(flipFlag, []() { stbi_set_flip_vertically_on_load(1); });
+
+        int channels;
+        unsigned char *pixels = stbi_load_from_memory(data, size, &image.width, &image.height,
+                &channels, 4);
+        if (!pixels) {
+            return false;
+        }
+        image.pixels.assign(pixels, pixels + size_t(image.width) * image.height * 4);
+        stbi_image_free(pixels);
+        return true;
+    }
+};
+
+#ifdef HAVE_TURBOJPEG
+class TurboJpegDecoder : public ImageDecoder
+{
+public:
+    const char *GetName() const override
+    {
+        return "turbojpeg";
+    }
+
+    bool CanDecode(const unsigned char *data, size_t size) const override
+    {
+        return size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+    }
+
+    bool Decode(const unsigned char *data, size_t size, Image &image) const override
+    {
+        tjhandle handle = GetHandle();
+        int subsampling, colorspace;
+        if (!handle || tjDecompressHeader3(handle, data, size, &image.width, &image.height,
+                    &subsampling, &colorspace) != 0) {
+            return false;
+        }
+        image.pixels.resize(size_t(image.width) * image.height * 4);
+        return tjDecompress2(handle, data, size, image.pixels.data(), image.width, 0,
+                image.height, TJPF_RGBA, TJFLAG_BOTTOMUP) == 0;
+    }
+
+private:
+    // A decompressor per thread; they are not thread safe
+    static tjhandle GetHandle()
+    {
+        struct Handle
+        {
+            ~Handle() { if (handle) tjDestroy(handle); }
+            tjhandle handle = tjInitDecompress();
+        };
+        thread_local Handle handle;
+        return handle.handle;
+    }
+};
+#endif
+
+}
+
+const std::vector<const ImageDecoder *> &ImageDecoder::GetDecoders()
+{
+    static const StbDecoder stb;
+#ifdef HAVE_TURBOJPEG
+    static const TurboJpegDecoder turbo;
+    static const std::vector<const ImageDecoder *> decoders = {&turbo, &stb};
+#else
+    static const std::vector<const ImageDecoder *> decoders = {&stb};
+#endif
+    return decoders;
+}
+
+const ImageDecoder *ImageDecoder::Find(const char *name)
+{
+    for (const ImageDecoder *decoder : GetDecoders()) {
+        if (std::strcmp(decoder->GetName(), name) == 0) {
+            return decoder;
+        }
+    }
+    return nullptr;
+}
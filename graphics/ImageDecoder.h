@@ -0,0 +1,33 @@
+#ifndef GRAPHICS_IMAGEDECODER_H
+#define GRAPHICS_IMAGEDECODER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Image.h"
+
+/*
+ * Decodes an encoded image in memory to RGBA8, bottom row first.
+ * Implementations are stateless from the caller's view and safe to use
+ * from several threads at once.
+ */
+class ImageDecoder
+{
+public:
+    virtual ~ImageDecoder() = default;
+
+    virtual const char *GetName() const = 0;
+    // Checks the file signature
+    virtual bool CanDecode(const unsigned char *data, size_t size) const = 0;
+    virtual bool Decode(const unsigned char *data, size_t size, Image &image) const = 0;
+
+    /*
+     * Available decoders, preferred first: turbojpeg if the build found it
+     * (HAVE_TURBOJPEG), then stb_image, which handles every format.
+     */
+    static const std::vector<const ImageDecoder *> &GetDecoders();
+    // nullptr if there is no decoder with that name
+    static const ImageDecoder *Find(const char *name);
+};
+
+#endif
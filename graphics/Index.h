@@ -0,0 +1,24 @@
+#ifndef GRAPHICS_INDEX_H
+#define GRAPHICS_INDEX_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+// Narrowest index type able to address vertexCount vertices
+inline GLenum IndexTypeFor(size_t vertexCount)
+{
+    return vertexCount <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+inline GLsizei IndexSize(GLenum type)
+{
+    return type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+inline std::vector<GLushort> NarrowIndices(const std::vector<GLuint> &indices)
+{
+    return std::vector<GLushort>(indices.begin(), indices.end());
+}
+
+#endif
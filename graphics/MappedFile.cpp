@@ -0,0 +1,87 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Bundle.h"
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const std::string &path, bool searchBundle)
+{
+    const unsigned char *bundled;
+    if (searchBundle && Bundle::Find(path, bundled, m_size)) {
+        m_data = const_cast<unsigned char *>(bundled);
+        return;
+    }
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            // The whole file is about to be handed to the driver
+            madvise(data, st.st_size, MADV_WILLNEED);
+            m_data = data;
+            m_size = st.st_size;
+            m_owned = true;
+        }
+    }
+    close(fd);
+}
+
+MappedFile::MappedFile(MappedFile &&other) :
+    m_data(other.m_data),
+    m_size(other.m_size),
+    m_owned(other.m_owned)
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_owned = false;
+}
+
+MappedFile::~MappedFile()
+{
+    Unmap();
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other)
+{
+    if (this != &other) {
+        Unmap();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        m_owned = other.m_owned;
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_owned = false;
+    }
+    return *this;
+}
+
+bool MappedFile::IsOpen() const
+{
+    return m_data != nullptr;
+}
+
+const unsigned char *MappedFile::Data() const
+{
+    return static_cast<const unsigned char *>(m_data);
+}
+
+size_t MappedFile::Size() const
+{
+    return m_size;
+}
+
+void MappedFile::Unmap()
+{
+    if (m_owned) {
+        munmap(m_data, m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_owned = false;
+}
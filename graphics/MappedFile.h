@@ -0,0 +1,35 @@
+#ifndef GRAPHICS_MAPPEDFILE_H
+#define GRAPHICS_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+/*
+ * Read-only memory mapping of a whole file. Paths found in the mounted
+ * Bundle are served from its mapping instead of opening the file.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const std::string &path, bool searchBundle = true);
+    MappedFile(const MappedFile &other) = delete;
+    MappedFile(MappedFile &&other);
+    ~MappedFile();
+
+    MappedFile &operator=(MappedFile &&other);
+
+    bool IsOpen() const;
+    const unsigned char *Data() const;
+    size_t Size() const;
+
+private:
+    void Unmap();
+
+private:
+    void *                                      m_data = nullptr;
+    size_t                                      m_size = 0;
+    bool                                        m_owned = false;
+};
+
+#endif
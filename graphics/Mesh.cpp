@@ -1,105 +1,279 @@
-#include "Mesh.h"
+#include <algorithm>
+#include <iostream>
 
-Mesh::Mesh(const std::vector<Vertex> &vertices, const std::vector<GLushort> &indices)
-{
-    if (indices.empty()) {
-        m_elCount = vertices.size();
-    } else {
-        m_elCount = indices.size();
-    }
-
-    glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
-
-    glGenBuffers(1, &m_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), 
-            vertices.data(), GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertices[0]),
-            reinterpret_cast<void *>(offsetof(Vertex, pos)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertices[0]),
-            reinterpret_cast<void *>(offsetof(Vertex, texCoords)));
-
-    if (!indices.empty()) {
-        glGenBuffers(1, &m_ebo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(indices[0]),
-                indices.data(), GL_STATIC_DRAW);
-    }
+#include "GpuTracker.h"
+#include "Mesh.h"
+#include "VertexPack.h"
 
-    glBindVertexArray(0);
-}
+Mesh::Stats Mesh::m_stats;
 
-Mesh::Mesh(const std::vector<VertexN> &vertices, const std::vector<GLushort> &indices)
+// Uploads straight from the mapped file, no intermediate copies unless packing
+Mesh::Mesh(const MeshFile &file, unsigned flags)
 {
-    if (indices.empty()) {
-        m_elCount = vertices.size();
+    const MeshFileHeader &h = file.Header();
+    if (h.indexCount == 0) {
+        m_elCount = h.vertexCount;
     } else {
-        m_elCount = indices.size();
+        m_elCount = h.indexCount;
     }
 
-    glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
+    UploadVertices(static_cast<const VertexN *>(file.VertexData()), h.vertexCount, flags);
 
-    glGenBuffers(1, &m_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), 
-            vertices.data(), GL_STATIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertices[0]),
-            reinterpret_cast<void *>(offsetof(VertexN, pos)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertices[0]),
-            reinterpret_cast<void *>(offsetof(VertexN, texCoords)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(vertices[0]),
-            reinterpret_cast<void *>(offsetof(VertexN, normal)));
-
-    if (!indices.empty()) {
-        glGenBuffers(1, &m_ebo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(indices[0]),
-                indices.data(), GL_STATIC_DRAW);
+    if (h.indexCount) {
+        UploadIndexData(file.IndexData(), h.indexCount,
+                h.indexSize == sizeof(GLushort) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
     }
 
     glBindVertexArray(0);
 }
 
-
 Mesh::Mesh(Mesh &&other) :
     m_vao(other.m_vao),
     m_vbo(other.m_vbo),
     m_ebo(other.m_ebo),
-    m_elCount(other.m_elCount)
+    m_depthVao(other.m_depthVao),
+    m_depthVbo(other.m_depthVbo),
+    m_elCount(other.m_elCount),
+    m_indexType(other.m_indexType),
+    m_attribMask(other.m_attribMask),
+    m_packed(other.m_packed),
+    m_posScale(other.m_posScale),
+    m_posOffset(other.m_posOffset)
 {
     other.m_vao = other.m_vbo = other.m_ebo = 0;
+    other.m_depthVao = other.m_depthVbo = 0;
 }
 
 Mesh::~Mesh()
+{
+    Release();
+}
+
+Mesh &Mesh::operator=(Mesh &&other)
+{
+    if (this != &other) {
+        Release();
+        m_vao = other.m_vao;
+        m_vbo = other.m_vbo;
+        m_ebo = other.m_ebo;
+        m_depthVao = other.m_depthVao;
+        m_depthVbo = other.m_depthVbo;
+        m_elCount = other.m_elCount;
+        m_indexType = other.m_indexType;
+        m_attribMask = other.m_attribMask;
+        m_packed = other.m_packed;
+        m_posScale = other.m_posScale;
+        m_posOffset = other.m_posOffset;
+        other.m_vao = other.m_vbo = other.m_ebo = 0;
+        other.m_depthVao = other.m_depthVbo = 0;
+    }
+    return *this;
+}
+
+void Mesh::Release()
 {
     if (m_ebo) {
+        GpuTracker::Untrack(GPU_OBJECT_BUFFER, m_ebo);
         glDeleteBuffers(1, &m_ebo);
     }
     if (m_vbo) {
+        GpuTracker::Untrack(GPU_OBJECT_BUFFER, m_vbo);
         glDeleteBuffers(1, &m_vbo);
     }
     if (m_vao) {
+        GpuTracker::Untrack(GPU_OBJECT_VERTEX_ARRAY, m_vao);
         glDeleteVertexArrays(1, &m_vao);
     }
+    if (m_depthVbo) {
+        GpuTracker::Untrack(GPU_OBJECT_BUFFER, m_depthVbo);
+        glDeleteBuffers(1, &m_depthVbo);
+    }
+    if (m_depthVao) {
+        GpuTracker::Untrack(GPU_OBJECT_VERTEX_ARRAY, m_depthVao);
+        glDeleteVertexArrays(1, &m_depthVao);
+    }
+    m_vao = m_vbo = m_ebo = 0;
+    m_depthVao = m_depthVbo = 0;
+}
+
+void Mesh::UploadVertices(const VertexN *vertices, size_t count, unsigned flags)
+{
+    if (!(flags & FLAG_PACKED)) {
+        UploadVertexData(vertices, count, VertexLayout<VertexN>::Describe(), flags);
+        return;
+    }
+
+    PackedVertices packed = PackVertices(vertices, count);
+    m_packed = true;
+    m_posScale = packed.posScale;
+    m_posOffset = packed.posOffset;
+    UploadVertexData(packed.vertices.data(), count, VertexLayout<VertexP>::Describe(), flags);
+
+    ++m_stats.packedMeshes;
+    m_stats.unpackedBytes += count * sizeof(VertexN);
+    m_stats.packedBytes += count * sizeof(VertexP);
+}
+
+// Creates the VAO and leaves it bound
+void Mesh::UploadVertexData(const void *vertices, size_t count, const VertexLayoutDesc &layout,
+        unsigned flags)
+{
+    glGenVertexArrays(1, &m_vao);
+    glBindVertexArray(m_vao);
+    GPU_TRACK(GPU_OBJECT_VERTEX_ARRAY, m_vao, GPU_MESH, 0, "mesh VAO");
+
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, count * layout.stride, vertices, GL_STATIC_DRAW);
+    GPU_TRACK(GPU_OBJECT_BUFFER, m_vbo, GPU_MESH, count * layout.stride, "mesh vertices");
+    SetupVertexLayout(layout);
+    m_attribMask = layout.locationMask;
+
+    if (flags & FLAG_DEPTH_STREAM) {
+        CreateDepthStream(vertices, count, layout);
+    }
+}
+
+/*
+ * Copies the position attribute into a tightly packed buffer with its own
+ * VAO, so that depth-only passes do not pull the other attributes through
+ * the vertex cache. Leaves m_vao bound.
+ */
+void Mesh::CreateDepthStream(const void *vertices, size_t count, const VertexLayoutDesc &layout)
+{
+    const VertexAttribute *position = nullptr;
+    for (size_t i = 0; i < layout.count; ++i) {
+        if (layout.attributes[i].location == ATTRIB_POSITION) {
+            position = &layout.attributes[i];
+        }
+    }
+    if (!position) {
+        std::cerr << "Depth stream requested for a mesh without positions" << std::endl;
+        return;
+    }
+
+    // Keep every position 4-byte aligned
+    VertexAttribute attribute = *position;
+    attribute.offset = 0;
+    VertexLayoutDesc depthLayout = {
+        static_cast<GLsizei>((position->bytes + 3) & ~size_t(3)), &attribute, 1,
+        1u << ATTRIB_POSITION
+    };
+    std::vector<unsigned char> positions(count * depthLayout.stride, 0);
+    const unsigned char *src = static_cast<const unsigned char *>(vertices) + position->offset;
+    for (size_t i = 0; i < count; ++i) {
+        std::copy(src + i * layout.stride, src + i * layout.stride + position->bytes,
+                &positions[i * depthLayout.stride]);
+    }
+
+    glGenVertexArrays(1, &m_depthVao);
+    glBindVertexArray(m_depthVao);
+    GPU_TRACK(GPU_OBJECT_VERTEX_ARRAY, m_depthVao, GPU_MESH, 0, "mesh depth VAO");
+
+    glGenBuffers(1, &m_depthVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_depthVbo);
+    glBufferData(GL_ARRAY_BUFFER, positions.size(), positions.data(), GL_STATIC_DRAW);
+    GPU_TRACK(GPU_OBJECT_BUFFER, m_depthVbo, GPU_MESH, positions.size(), "mesh depth stream");
+    SetupVertexLayout(depthLayout);
+
+    ++m_stats.depthStreams;
+    m_stats.depthStreamBytes += positions.size();
+
+    glBindVertexArray(m_vao);
+}
+
+// Uses 16-bit indices whenever the mesh is small enough for them
+void Mesh::UploadIndices(const std::vector<GLuint> &indices, size_t vertexCount)
+{
+    if (indices.empty()) {
+        return;
+    }
+    if (IndexTypeFor(vertexCount) == GL_UNSIGNED_SHORT) {
+        std::vector<GLushort> narrow = NarrowIndices(indices);
+        UploadIndexData(narrow.data(), narrow.size(), GL_UNSIGNED_SHORT);
+    } else {
+        UploadIndexData(indices.data(), indices.size(), GL_UNSIGNED_INT);
+    }
+}
+
+// Expects m_vao to be bound, the depth stream VAO shares the buffer
+void Mesh::UploadIndexData(const void *data, GLsizei count, GLenum type)
+{
+    m_indexType = type;
+
+    glGenBuffers(1, &m_ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(count) * IndexSize(type), data,
+            GL_STATIC_DRAW);
+    GPU_TRACK(GPU_OBJECT_BUFFER, m_ebo, GPU_MESH, size_t(count) * IndexSize(type), "mesh indices");
+
+    if (m_depthVao) {
+        glBindVertexArray(m_depthVao);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+        glBindVertexArray(m_vao);
+    }
+}
+
+bool Mesh::IsPacked() const
+{
+    return m_packed;
+}
+
+const glm::vec3 &Mesh::GetPosScale() const
+{
+    return m_posScale;
 }
-    
+
+const glm::vec3 &Mesh::GetPosOffset() const
+{
+    return m_posOffset;
+}
+
+unsigned Mesh::GetAttribMask() const
+{
+    return m_attribMask;
+}
+
+bool Mesh::IsReady() const
+{
+    return m_vao != 0;
+}
+
 void Mesh::Draw() const
 {
+    if (!m_vao) {
+        return;
+    }
     glBindVertexArray(m_vao);
     if (m_ebo) {
-        glDrawElements(GL_TRIANGLES, m_elCount, GL_UNSIGNED_SHORT, nullptr);
+        glDrawElements(GL_TRIANGLES, m_elCount, m_indexType, nullptr);
+    } else {
+        glDrawArrays(GL_TRIANGLES, 0, m_elCount);
+    }
+}
+
+void Mesh::DrawDepth() const
+{
+    if (!m_vao) {
+        return;
+    }
+    glBindVertexArray(m_depthVao ? m_depthVao : m_vao);
+    if (m_ebo) {
+        glDrawElements(GL_TRIANGLES, m_elCount, m_indexType, nullptr);
     } else {
         glDrawArrays(GL_TRIANGLES, 0, m_elCount);
     }
 }
         
 
+const Mesh::Stats &Mesh::GetStats()
+{
+    return m_stats;
+}
+
+void Mesh::PrintStats()
+{
+    std::cout << "Meshes: " << m_stats.packedMeshes << " packed, " << m_stats.unpackedBytes <<
+            " -> " << m_stats.packedBytes << " vertex bytes; " << m_stats.depthStreams <<
+            " depth streams, " << m_stats.depthStreamBytes << " bytes" << std::endl;
+}
@@ -2,30 +2,110 @@
 #define GRAPHICS_MESH_H
 
 #include <GL/glew.h>
+#include <cstdint>
 #include <vector>
+#include <glm/glm.hpp>
 
+#include "Index.h"
 #include "Vertex.h"
+#include "VertexLayout.h"
+#include "MeshFile.h"
 #include "Texture.h"
 #include "Shader.h"
 
 class Mesh
 {
 public:
-    Mesh(const std::vector<Vertex> &vertices, const std::vector<GLushort> &indices);
-    Mesh(const std::vector<VertexN> &vertices, const std::vector<GLushort> &indices);
+    enum {
+        FLAG_PACKED = 1 << 0,                   // upload VertexN as VertexP
+        FLAG_DEPTH_STREAM = 1 << 1              // keep positions in a separate buffer
+    };
+
+    // Empty until a loaded mesh is moved in, draws nothing
+    Mesh() = default;
+    // V is any vertex type with a VertexLayout specialization
+    template <class V>
+    Mesh(const std::vector<V> &vertices, const std::vector<GLuint> &indices,
+            unsigned flags = 0);
+    Mesh(const MeshFile &file, unsigned flags = 0);
     Mesh(const Mesh &other) = delete;
     Mesh(Mesh &&other);
     ~Mesh();
 
+    Mesh &operator=(Mesh &&other);
+
+    bool IsReady() const;
     void Draw() const;
+    // Draws from the position-only stream if the mesh has one
+    void DrawDepth() const;
+
+    // Vertex decoding parameters for the shaders reading this mesh
+    bool IsPacked() const;
+    const glm::vec3 &GetPosScale() const;
+    const glm::vec3 &GetPosOffset() const;
+    // Bit per attribute location the mesh provides
+    unsigned GetAttribMask() const;
+
+    struct Stats
+    {
+        // Uploads with FLAG_PACKED, vertex bytes as VertexN and as VertexP
+        uint64_t                                packedMeshes = 0;
+        uint64_t                                unpackedBytes = 0;
+        uint64_t                                packedBytes = 0;
+        // Position-only buffers made for FLAG_DEPTH_STREAM
+        uint64_t                                depthStreams = 0;
+        uint64_t                                depthStreamBytes = 0;
+    };
+    // Over all meshes, reloads included
+    static const Stats &GetStats();
+    static void PrintStats();
 
 private:
+    template <class V>
+    void UploadVertices(const V *vertices, size_t count, unsigned flags);
+    void UploadVertices(const VertexN *vertices, size_t count, unsigned flags);
+    void UploadVertexData(const void *vertices, size_t count, const VertexLayoutDesc &layout,
+            unsigned flags);
+    void CreateDepthStream(const void *vertices, size_t count, const VertexLayoutDesc &layout);
+    void UploadIndices(const std::vector<GLuint> &indices, size_t vertexCount);
+    void UploadIndexData(const void *data, GLsizei count, GLenum type);
+    void Release();
 
 private:
     GLuint                                      m_vao = 0;
     GLuint                                      m_vbo = 0;
     GLuint                                      m_ebo = 0;
-    GLsizei                                     m_elCount;
+    GLuint                                      m_depthVao = 0;
+    GLuint                                      m_depthVbo = 0;
+    GLsizei                                     m_elCount = 0;
+    GLenum                                      m_indexType = GL_UNSIGNED_SHORT;
+    unsigned                                    m_attribMask = 0;
+
+    bool                                        m_packed = false;
+    glm::vec3                                   m_posScale = {1.0, 1.0, 1.0};
+    glm::vec3                                   m_posOffset = {0.0, 0.0, 0.0};
+    static Stats                                m_stats;
 };
 
+template <class V>
+Mesh::Mesh(const std::vector<V> &vertices, const std::vector<GLuint> &indices, unsigned flags)
+{
+    if (indices.empty()) {
+        m_elCount = vertices.size();
+    } else {
+        m_elCount = indices.size();
+    }
+
+    UploadVertices(vertices.data(), vertices.size(), flags);
+    UploadIndices(indices, vertices.size());
+
+    glBindVertexArray(0);
+}
+
+template <class V>
+void Mesh::UploadVertices(const V *vertices, size_t count, unsigned flags)
+{
+    UploadVertexData(vertices, count, VertexLayout<V>::Describe(), flags);
+}
+
 #endif
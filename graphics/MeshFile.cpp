@@ -0,0 +1,147 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "MeshFile.h"
+
+static const char MESH_FILE_MAGIC[4] = {'M', 'S', 'H', 'B'};
+
+static uint64_t AlignUp(uint64_t offset)
+{
+    return (offset + MESH_FILE_ALIGNMENT - 1) & ~uint64_t(MESH_FILE_ALIGNMENT - 1);
+}
+
+MeshFile::MeshFile(const std::string &path) :
+    m_file(path)
+{
+    if (!m_file.IsOpen()) {
+        return;
+    }
+    if (Validate(path)) {
+        m_header = reinterpret_cast<const MeshFileHeader *>(m_file.Data());
+    } else {
+        m_file = MappedFile();
+    }
+}
+
+bool MeshFile::IsOpen() const
+{
+    return m_header != nullptr;
+}
+
+const MeshFileHeader &MeshFile::Header() const
+{
+    return *m_header;
+}
+
+const void *MeshFile::VertexData() const
+{
+    return m_file.Data() + m_header->vertexOffset;
+}
+
+const void *MeshFile::IndexData() const
+{
+    return m_header->indexCount ? m_file.Data() + m_header->indexOffset : nullptr;
+}
+
+bool MeshFile::Validate(const std::string &path) const
+{
+    if (m_file.Size() < sizeof(MeshFileHeader)) {
+        std::cerr << "Mesh file is too small: " << path << std::endl;
+        return false;
+    }
+    MeshFileHeader h;
+    std::memcpy(&h, m_file.Data(), sizeof(h));
+    if (std::memcmp(h.magic, MESH_FILE_MAGIC, sizeof(h.magic)) != 0) {
+        std::cerr << "Not a binary mesh file: " << path << std::endl;
+        return false;
+    }
+    if (h.version != MESH_FILE_VERSION) {
+        std::cerr << "Unsupported mesh file version " << h.version <<
+                ": " << path << std::endl;
+        return false;
+    }
+    if (h.vertexFormat != MESH_VERTEX_FORMAT_N || h.vertexStride != sizeof(VertexN)) {
+        std::cerr << "Unsupported vertex format in mesh file: " << path << std::endl;
+        return false;
+    }
+    if (h.indexCount && h.indexSize != sizeof(GLushort) && h.indexSize != sizeof(GLuint)) {
+        std::cerr << "Unsupported index size in mesh file: " << path << std::endl;
+        return false;
+    }
+    // Subtractions, so a crafted header cannot wrap the bounds around
+    uint64_t size = m_file.Size();
+    if (h.vertexOffset % MESH_FILE_ALIGNMENT || h.indexOffset % MESH_FILE_ALIGNMENT ||
+            h.vertexOffset > size || h.vertexCount > (size - h.vertexOffset) / h.vertexStride ||
+            h.indexOffset > size ||
+            (h.indexCount && h.indexCount > (size - h.indexOffset) / h.indexSize)) {
+        std::cerr << "Corrupted mesh file: " << path << std::endl;
+        return false;
+    }
+    if (!ValidateIndices(h)) {
+        std::cerr << "Index out of range in mesh file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Once at load, the indices go straight to glDrawElements
+bool MeshFile::ValidateIndices(const MeshFileHeader &h) const
+{
+    const unsigned char *data = m_file.Data() + h.indexOffset;
+    for (uint32_t i = 0; i < h.indexCount; ++i) {
+        uint32_t index;
+        if (h.indexSize == sizeof(GLushort)) {
+            GLushort narrow;
+            std::memcpy(&narrow, data + i * sizeof(GLushort), sizeof(narrow));
+            index = narrow;
+        } else {
+            std::memcpy(&index, data + i * sizeof(GLuint), sizeof(index));
+        }
+        if (index >= h.vertexCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MeshFile::Write(const std::string &path,
+        const std::vector<VertexN> &vertices,
+        const std::vector<GLuint> &indices)
+{
+    MeshFileHeader h = {};
+    std::memcpy(h.magic, MESH_FILE_MAGIC, sizeof(h.magic));
+    h.version = MESH_FILE_VERSION;
+    h.vertexFormat = MESH_VERTEX_FORMAT_N;
+    h.vertexStride = sizeof(VertexN);
+    h.vertexCount = vertices.size();
+    h.indexSize = indices.empty() ? 0 : IndexSize(IndexTypeFor(vertices.size()));
+    h.indexCount = indices.size();
+    h.vertexOffset = AlignUp(sizeof(h));
+    h.indexOffset = AlignUp(h.vertexOffset + vertices.size() * sizeof(VertexN));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Could not create mesh file: " << path << std::endl;
+        return false;
+    }
+    static const char padding[MESH_FILE_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    file.write(padding, h.vertexOffset - sizeof(h));
+    file.write(reinterpret_cast<const char *>(vertices.data()),
+            vertices.size() * sizeof(VertexN));
+    file.write(padding, h.indexOffset - h.vertexOffset - vertices.size() * sizeof(VertexN));
+    if (h.indexSize == sizeof(GLushort)) {
+        std::vector<GLushort> narrow = NarrowIndices(indices);
+        file.write(reinterpret_cast<const char *>(narrow.data()),
+                narrow.size() * sizeof(GLushort));
+    } else {
+        file.write(reinterpret_cast<const char *>(indices.data()),
+                indices.size() * sizeof(GLuint));
+    }
+    if (!file) {
+        std::cerr << "Failed to write mesh file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
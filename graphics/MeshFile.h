@@ -0,0 +1,66 @@
+#ifndef GRAPHICS_MESHFILE_H
+#define GRAPHICS_MESHFILE_H
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Index.h"
+#include "MappedFile.h"
+#include "Vertex.h"
+
+/*
+ * Binary mesh container (.meshb):
+ *   MeshFileHeader
+ *   vertex blob, aligned to MESH_FILE_ALIGNMENT
+ *   index blob, aligned to MESH_FILE_ALIGNMENT
+ * Blobs are stored exactly as they are uploaded to the GPU.
+ */
+enum {
+    MESH_FILE_VERSION = 1,
+    MESH_FILE_ALIGNMENT = 16
+};
+
+enum {
+    MESH_VERTEX_FORMAT_N = 1                    // VertexN
+};
+
+struct MeshFileHeader
+{
+    char                                        magic[4];       // "MSHB"
+    uint32_t                                    version;
+    uint32_t                                    vertexFormat;
+    uint32_t                                    vertexStride;
+    uint32_t                                    vertexCount;
+    uint32_t                                    indexSize;      // 0 if not indexed, 2 or 4
+    uint32_t                                    indexCount;
+    uint32_t                                    reserved;
+    uint64_t                                    vertexOffset;
+    uint64_t                                    indexOffset;
+};
+
+class MeshFile
+{
+public:
+    MeshFile(const std::string &path);
+
+    bool IsOpen() const;
+    const MeshFileHeader &Header() const;
+    const void *VertexData() const;
+    const void *IndexData() const;
+
+    static bool Write(const std::string &path,
+            const std::vector<VertexN> &vertices,
+            const std::vector<GLuint> &indices);
+
+private:
+    bool Validate(const std::string &path) const;
+    bool ValidateIndices(const MeshFileHeader &h) const;
+
+private:
+    MappedFile                                  m_file;
+    const MeshFileHeader *                      m_header = nullptr;
+};
+
+#endif
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <unordered_map>
+#include <utility>
+
+#include "Hash.h"
+#include "MeshOptimize.h"
+
+namespace {
+
+struct VertexHash
+{
+    size_t operator()(const VertexN &v) const
+    {
+        return Fnv1a(&v, sizeof(v));
+    }
+};
+
+struct VertexEqual
+{
+    bool operator()(const VertexN &a, const VertexN &b) const
+    {
+        return std::memcmp(&a, &b, sizeof(VertexN)) == 0;
+    }
+};
+
+// Forsyth's scoring, see "Linear-Speed Vertex Cache Optimisation"
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRI_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+float VertexScore(int cachePos, unsigned liveTris)
+{
+    if (liveTris == 0) {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePos >= 0) {
+        if (cachePos < 3) {
+            score = LAST_TRI_SCORE;
+        } else {
+            float scaler = 1.0f / (OPTIMIZE_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cachePos - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+    score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(liveTris), -VALENCE_BOOST_POWER);
+    return score;
+}
+
+// Fallback candidates: highest score first, then the lowest index
+using Candidate = std::pair<float, size_t>;
+
+bool CandidateLess(const Candidate &a, const Candidate &b)
+{
+    return a.first < b.first || (a.first == b.first && a.second > b.second);
+}
+
+}
+
+float ComputeACMR(const std::vector<GLuint> &indices, size_t vertexCount)
+{
+    if (indices.empty()) {
+        return vertexCount ? 3.0f : 0.0f;
+    }
+    std::vector<size_t> stamp(vertexCount, 0);
+    size_t misses = 0;
+    for (GLuint ind : indices) {
+        // A vertex is in the FIFO if it was pushed during the last ACMR_CACHE_SIZE misses
+        if (stamp[ind] == 0 || misses - stamp[ind] >= ACMR_CACHE_SIZE) {
+            ++misses;
+            stamp[ind] = misses;
+        }
+    }
+    return static_cast<float>(misses) / (indices.size() / 3);
+}
+
+void DeduplicateVertices(std::vector<VertexN> &vertices, std::vector<GLuint> &indices)
+{
+    if (indices.empty()) {
+        indices.resize(vertices.size());
+        std::iota(indices.begin(), indices.end(), 0);
+    }
+
+    std::unordered_map<VertexN, GLuint, VertexHash, VertexEqual> unique;
+    unique.reserve(vertices.size());
+    std::vector<VertexN> result;
+    result.reserve(vertices.size());
+    std::vector<GLuint> remap(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        auto [it, inserted] = unique.insert({vertices[i], static_cast<GLuint>(result.size())});
+        if (inserted) {
+            result.push_back(vertices[i]);
+        }
+        remap[i] = it->second;
+    }
+    for (GLuint &ind : indices) {
+        ind = remap[ind];
+    }
+    vertices.swap(result);
+}
+
+void OptimizeVertexCache(std::vector<GLuint> &indices, size_t vertexCount)
+{
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) {
+        return;
+    }
+
+    // Vertex -> adjacent triangles
+    std::vector<unsigned> liveTris(vertexCount, 0);
+    for (GLuint ind : indices) {
+        ++liveTris[ind];
+    }
+    std::vector<size_t> adjStart(vertexCount, 0);
+    for (size_t v = 1; v < vertexCount; ++v) {
+        adjStart[v] = adjStart[v - 1] + liveTris[v - 1];
+    }
+    std::vector<size_t> adjacency(indices.size());
+    std::vector<size_t> fill(adjStart);
+    for (size_t t = 0; t < triCount; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            adjacency[fill[indices[3 * t + k]]++] = t;
+        }
+    }
+
+    std::vector<int> cachePos(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        vertexScore[v] = VertexScore(-1, liveTris[v]);
+    }
+    std::vector<float> triScore(triCount);
+    for (size_t t = 0; t < triCount; ++t) {
+        triScore[t] = vertexScore[indices[3 * t]] + vertexScore[indices[3 * t + 1]] +
+                vertexScore[indices[3 * t + 2]];
+    }
+
+    /*
+     * The fallback only runs when no live triangle touches the cache, and
+     * scores of vertices outside the cache do not change. So a heap entry
+     * is current if it matches triScore; triangles are pushed again when
+     * their vertices leave the cache, and stale entries are skipped.
+     */
+    std::vector<Candidate> candidates(triCount);
+    for (size_t t = 0; t < triCount; ++t) {
+        candidates[t] = {triScore[t], t};
+    }
+    std::make_heap(candidates.begin(), candidates.end(), CandidateLess);
+
+    std::vector<char> emitted(triCount, false);
+    std::vector<GLuint> result;
+    result.reserve(indices.size());
+    std::vector<GLuint> cache;
+    cache.reserve(OPTIMIZE_CACHE_SIZE + 3);
+    std::vector<GLuint> touched;
+    touched.reserve(OPTIMIZE_CACHE_SIZE + 3);
+    std::vector<GLuint> evicted;
+    evicted.reserve(3);
+    size_t emittedCount = 0;
+
+    for (;;) {
+        // Best triangle touching the cache, otherwise the best remaining one
+        long best = -1;
+        float bestScore = -1.0f;
+        for (GLuint v : cache) {
+            for (size_t a = adjStart[v]; a < adjStart[v] + liveTris[v]; ++a) {
+                size_t t = adjacency[a];
+                if (!emitted[t] && triScore[t] > bestScore) {
+                    best = t;
+                    bestScore = triScore[t];
+                }
+            }
+        }
+        if (best == -1) {
+            if (emittedCount == triCount) {
+                break;
+            }
+            while (best == -1) {
+                Candidate candidate = candidates.front();
+                std::pop_heap(candidates.begin(), candidates.end(), CandidateLess);
+                candidates.pop_back();
+                size_t t = candidate.second;
+                if (!emitted[t] && triScore[t] == candidate.first) {
+                    best = t;
+                }
+            }
+        }
+
+        emitted[best] = true;
+        ++emittedCount;
+        for (int k = 0; k < 3; ++k) {
+            GLuint v = indices[3 * best + k];
+            result.push_back(v);
+            // Remove the triangle from the live part of the adjacency list
+            size_t *first = &adjacency[adjStart[v]];
+            size_t *last = first + liveTris[v];
+            *std::find(first, last, static_cast<size_t>(best)) = *(last - 1);
+            --liveTris[v];
+            auto it = std::find(cache.begin(), cache.end(), v);
+            if (it != cache.end()) {
+                cache.erase(it);
+            }
+            cache.insert(cache.begin(), v);
+        }
+        // Vertices pushed out of the cache lose their position bonus
+        touched.assign(cache.begin(), cache.end());
+        evicted.clear();
+        for (size_t i = OPTIMIZE_CACHE_SIZE; i < cache.size(); ++i) {
+            evicted.push_back(cache[i]);
+            cachePos[cache[i]] = -1;
+            vertexScore[cache[i]] = VertexScore(-1, liveTris[cache[i]]);
+        }
+        if (cache.size() > OPTIMIZE_CACHE_SIZE) {
+            cache.resize(OPTIMIZE_CACHE_SIZE);
+        }
+        for (size_t i = 0; i < cache.size(); ++i) {
+            cachePos[cache[i]] = i;
+            vertexScore[cache[i]] = VertexScore(i, liveTris[cache[i]]);
+        }
+        // Evicted vertices are included so the fallback sees current scores
+        for (GLuint v : touched) {
+            for (size_t a = adjStart[v]; a < adjStart[v] + liveTris[v]; ++a) {
+                size_t t = adjacency[a];
+                triScore[t] = vertexScore[indices[3 * t]] + vertexScore[indices[3 * t + 1]] +
+                        vertexScore[indices[3 * t + 2]];
+            }
+        }
+        for (GLuint v : evicted) {
+            for (size_t a = adjStart[v]; a < adjStart[v] + liveTris[v]; ++a) {
+                candidates.push_back({triScore[adjacency[a]], adjacency[a]});
+                std::push_heap(candidates.begin(), candidates.end(), CandidateLess);
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void OptimizeVertexFetch(std::vector<VertexN> &vertices, std::vector<GLuint> &indices)
+{
+    const GLuint UNUSED = ~0u;
+    std::vector<GLuint> remap(vertices.size(), UNUSED);
+    std::vector<VertexN> result;
+    result.reserve(vertices.size());
+    for (GLuint &ind : indices) {
+        if (remap[ind] == UNUSED) {
+            remap[ind] = result.size();
+            result.push_back(vertices[ind]);
+        }
+        ind = remap[ind];
+    }
+    vertices.swap(result);
+}
+
+void OptimizeMesh(const std::string &name,
+        std::vector<VertexN> &vertices, std::vector<GLuint> &indices)
+{
+    std::cout << name << ": ACMR " << ComputeACMR(indices, vertices.size()) <<
+            " (" << vertices.size() << " vertices)";
+    DeduplicateVertices(vertices, indices);
+    std::cout << ", dedup " << ComputeACMR(indices, vertices.size()) <<
+            " (" << vertices.size() << " vertices)";
+    OptimizeVertexCache(indices, vertices.size());
+    std::cout << ", cache " << ComputeACMR(indices, vertices.size());
+    OptimizeVertexFetch(vertices, indices);
+    std::cout << ", fetch " << ComputeACMR(indices, vertices.size()) << std::endl;
+}
@@ -0,0 +1,29 @@
+#ifndef GRAPHICS_MESHOPTIMIZE_H
+#define GRAPHICS_MESHOPTIMIZE_H
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+#include "Vertex.h"
+
+enum {
+    ACMR_CACHE_SIZE = 16,                       // FIFO, as in most hardware
+    OPTIMIZE_CACHE_SIZE = 32                    // LRU used by the optimizer
+};
+
+// Average cache miss ratio: transformed vertices per triangle
+float ComputeACMR(const std::vector<GLuint> &indices, size_t vertexCount);
+
+// Merges bit-identical vertices and builds the index buffer
+void DeduplicateVertices(std::vector<VertexN> &vertices, std::vector<GLuint> &indices);
+// Reorders triangles for post-transform cache hits (Forsyth)
+void OptimizeVertexCache(std::vector<GLuint> &indices, size_t vertexCount);
+// Reorders vertices in the order of their first use
+void OptimizeVertexFetch(std::vector<VertexN> &vertices, std::vector<GLuint> &indices);
+
+// Runs all of the above and prints ACMR after every stage
+void OptimizeMesh(const std::string &name,
+        std::vector<VertexN> &vertices, std::vector<GLuint> &indices);
+
+#endif
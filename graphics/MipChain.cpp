@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "MipChain.h"
+
+namespace {
+
+constexpr int LINEAR_STEPS = 4096;
+
+struct SrgbTables
+{
+    SrgbTables()
+    {
+        for (int i = 0; i < 256; ++i) {
+            float c = i / 255.0f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < LINEAR_STEPS; ++i) {
+            float l = i / float(LINEAR_STEPS - 1);
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            fromLinear[i] = static_cast<unsigned char>(c * 255.0f + 0.5f);
+        }
+    }
+
+    float                                       toLinear[256];
+    unsigned char                               fromLinear[LINEAR_STEPS];
+};
+
+const SrgbTables &GetSrgbTables()
+{
+    static const SrgbTables tables;
+    return tables;
+}
+
+// RGBA floats, 4 per pixel
+struct LinearImage
+{
+    int                                         width = 0;
+    int                                         height = 0;
+    std::vector<float>                          pixels;
+};
+
+LinearImage ToLinear(const Image &image, bool srgb)
+{
+    const SrgbTables &tables = GetSrgbTables();
+    LinearImage dst;
+    dst.width = image.width;
+    dst.height = image.height;
+    dst.pixels.resize(image.pixels.size());
+    for (size_t i = 0; i < image.pixels.size(); i += 4) {
+        for (size_t c = 0; c < 3; ++c) {
+            dst.pixels[i + c] = srgb ? tables.toLinear[image.pixels[i + c]] :
+                    image.pixels[i + c] / 255.0f;
+        }
+        dst.pixels[i + 3] = image.pixels[i + 3] / 255.0f;
+    }
+    return dst;
+}
+
+Image FromLinear(const LinearImage &image, bool srgb)
+{
+    const SrgbTables &tables = GetSrgbTables();
+    Image dst;
+    dst.width = image.width;
+    dst.height = image.height;
+    dst.pixels.resize(image.pixels.size());
+    float colorScale = srgb ? LINEAR_STEPS - 1 : 255.0f;
+#ifdef __SSE2__
+    const __m128 scale = _mm_setr_ps(colorScale, colorScale, colorScale, 255.0f);
+    const __m128 half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    alignas(16) int32_t q[4];
+    for (size_t i = 0; i < image.pixels.size(); i += 4) {
+        __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&image.pixels[i]), zero), one);
+        _mm_store_si128(reinterpret_cast<__m128i *>(q),
+                _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half)));
+        for (size_t c = 0; c < 3; ++c) {
+            dst.pixels[i + c] = srgb ? tables.fromLinear[q[c]] : q[c];
+        }
+        dst.pixels[i + 3] = q[3];
+    }
+#else
+    for (size_t i = 0; i < image.pixels.size(); i += 4) {
+        for (size_t c = 0; c < 4; ++c) {
+            float v = std::clamp(image.pixels[i + c], 0.0f, 1.0f);
+            int q = static_cast<int>(v * (c < 3 ? colorScale : 255.0f) + 0.5f);
+            dst.pixels[i + c] = srgb && c < 3 ? tables.fromLinear[q] : q;
+        }
+    }
+#endif
+    return dst;
+}
+
+LinearImage Downsample(const LinearImage &src)
+{
+    LinearImage dst;
+    dst.width = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.pixels.resize(size_t(dst.width) * dst.height * 4);
+    for (int y = 0; y < dst.height; ++y) {
+        int y0 = std::min(2 * y, src.height - 1), y1 = std::min(2 * y + 1, src.height - 1);
+        const float *row0 = &src.pixels[size_t(y0) * src.width * 4];
+        const float *row1 = &src.pixels[size_t(y1) * src.width * 4];
+        float *out = &dst.pixels[size_t(y) * dst.width * 4];
+        for (int x = 0; x < dst.width; ++x, out += 4) {
+            int x0 = std::min(2 * x, src.width - 1) * 4, x1 = std::min(2 * x + 1, src.width - 1) * 4;
+#ifdef __SSE2__
+            __m128 sum = _mm_add_ps(
+                    _mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)),
+                    _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+            _mm_storeu_ps(out, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+            for (int c = 0; c < 4; ++c) {
+                out[c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+            }
+#endif
+        }
+    }
+    return dst;
+}
+
+}
+
+// Each level is filtered from the previous one kept in float, so rounding doesn't accumulate
+std::vector<Image> BuildMipChain(const Image &base, bool srgb)
+{
+    std::vector<Image> levels;
+    if (base.pixels.empty()) {
+        return levels;
+    }
+    LinearImage level = ToLinear(base, srgb);
+    while (level.width > 1 || level.height > 1) {
+        level = Downsample(level);
+        levels.push_back(FromLinear(level, srgb));
+    }
+    return levels;
+}
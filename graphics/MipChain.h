@@ -0,0 +1,14 @@
+#ifndef GRAPHICS_MIPCHAIN_H
+#define GRAPHICS_MIPCHAIN_H
+
+#include <vector>
+
+#include "Image.h"
+
+/*
+ * Levels 1..n below base down to 1x1, 2x2 box filtered.
+ * sRGB colour is averaged in linear light; alpha is always linear.
+ */
+std::vector<Image> BuildMipChain(const Image &base, bool srgb = true);
+
+#endif
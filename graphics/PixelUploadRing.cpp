@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include "GpuTracker.h"
+#include "PixelUploadRing.h"
+
+namespace {
+
+// Keeps every range aligned for any GL_UNPACK_ALIGNMENT and for SIMD writes
+constexpr size_t RANGE_ALIGNMENT = 64;
+
+size_t AlignUp(size_t offset)
+{
+    return (offset + RANGE_ALIGNMENT - 1) / RANGE_ALIGNMENT * RANGE_ALIGNMENT;
+}
+
+}
+
+PixelUploadRing::PixelUploadRing(size_t size) :
+    m_size(size)
+{
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+    if (GLEW_ARB_buffer_storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, m_size, nullptr, flags);
+        m_persistent = static_cast<unsigned char *>(
+                glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_size, flags));
+        if (!m_persistent) {
+            std::cerr << "Failed to map the pixel upload ring persistently" << std::endl;
+        }
+    }
+    if (!m_persistent) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, m_size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    GPU_TRACK(GPU_OBJECT_BUFFER, m_buffer, GPU_STAGING, m_size, "pixel upload ring");
+}
+
+PixelUploadRing::~PixelUploadRing()
+{
+    for (const Batch &batch : m_batches) {
+        glDeleteSync(batch.fence);
+    }
+    if (m_persistent) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    GpuTracker::Untrack(GPU_OBJECT_BUFFER, m_buffer);
+    glDeleteBuffers(1, &m_buffer);
+}
+
+bool PixelUploadRing::IsPersistent() const
+{
+    return m_persistent != nullptr;
+}
+
+StagingRange PixelUploadRing::Reserve(size_t size)
+{
+    if (!m_persistent || size == 0) {
+        return {};
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t begin;
+    if (!Allocate(size, begin)) {
+        return {};
+    }
+    m_regions.push_back({begin, begin + size});
+    m_stats.reservedBytes += size;
+    return {m_persistent + begin, size};
+}
+
+void PixelUploadRing::Release(const StagingRange &range)
+{
+    if (!range) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t id;
+    if (Region *region = FindRegion(range.data, id)) {
+        region->released = true;
+        PopFreeRegions();
+    }
+}
+
+const void *PixelUploadRing::Stage(const void *data, size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        uint64_t id;
+        if (Region *region = FindRegion(data, id)) {
+            if (std::find(m_open.begin(), m_open.end(), id) == m_open.end()) {
+                m_open.push_back(id);
+                ++region->pending;
+            }
+            ++m_stats.uploads;
+            m_stats.bytes += size;
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+            return reinterpret_cast<const void *>(
+                    static_cast<const unsigned char *>(data) - m_persistent);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const void *offset = StageCopy(data, size);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.seconds += elapsed.count();
+    return offset;
+}
+
+void PixelUploadRing::Finish()
+{
+    CloseBatch();
+    Recycle();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void PixelUploadRing::Recycle()
+{
+    while (!m_batches.empty() &&
+            glClientWaitSync(m_batches.front().fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+        RetireBatch();
+    }
+}
+
+PixelUploadRing::Stats PixelUploadRing::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void PixelUploadRing::PrintStats() const
+{
+    Stats stats = GetStats();
+    double mb = stats.bytes / double(1 << 20);
+    double copied = stats.copiedBytes / double(1 << 20);
+    std::cout << "Pixel upload ring: " << stats.uploads << " uploads, " << mb << " MiB (" <<
+            stats.reservedBytes / double(1 << 20) << " MiB written by loaders), " <<
+            (stats.seconds > 0.0 ? copied / stats.seconds : 0.0) << " MiB/s staging, " <<
+            stats.stalls << " stalls, " << stats.fallbacks << " fallbacks" << std::endl;
+}
+
+void *PixelUploadRing::Map(size_t size)
+{
+    size_t begin = AlignUp(m_head);
+    bool wrap = begin + size > m_size;
+    if (wrap) {
+        begin = 0;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+    // The driver keeps the old storage alive for pending reads
+    if (wrap) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, m_size, nullptr, GL_STREAM_DRAW);
+    }
+    void *data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, begin, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!data) {
+        std::cerr << "Failed to map the pixel upload ring" << std::endl;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return nullptr;
+    }
+    m_mapBegin = begin;
+    m_head = begin + size;
+    return data;
+}
+
+const void *PixelUploadRing::Unmap()
+{
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    return reinterpret_cast<const void *>(m_mapBegin);
+}
+
+// Ranges are handed out in ring order, so the free space is behind the newest region
+bool PixelUploadRing::Allocate(size_t size, size_t &begin)
+{
+    if (size > m_size) {
+        return false;
+    }
+    if (m_regions.empty()) {
+        begin = 0;
+        return true;
+    }
+    size_t tail = m_regions.front().begin;
+    size_t head = AlignUp(m_regions.back().end);
+    bool wrapped = m_regions.back().begin < tail;
+    if (!wrapped && head + size <= m_size) {
+        begin = head;
+        return true;
+    }
+    begin = wrapped ? head : 0;
+    return begin + size <= tail;
+}
+
+PixelUploadRing::Region *PixelUploadRing::FindRegion(const void *data, uint64_t &id)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    if (!m_persistent || p < m_persistent || p >= m_persistent + m_size) {
+        return nullptr;
+    }
+    size_t offset = p - m_persistent;
+    for (size_t i = 0; i < m_regions.size(); ++i) {
+        Region &region = m_regions[i];
+        if (!region.released && region.begin <= offset && offset < region.end) {
+            id = m_firstRegion + i;
+            return &region;
+        }
+    }
+    return nullptr;
+}
+
+void PixelUploadRing::PopFreeRegions()
+{
+    while (!m_regions.empty() && m_regions.front().released && m_regions.front().pending == 0) {
+        m_regions.pop_front();
+        ++m_firstRegion;
+    }
+}
+
+// Data produced on the GL thread, or by a loader that found the ring full
+const void *PixelUploadRing::StageCopy(const void *data, size_t size)
+{
+    if (size > m_size) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.fallbacks;
+        return nullptr;
+    }
+
+    if (!m_persistent) {
+        void *dst = Map(size);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!dst) {
+            ++m_stats.fallbacks;
+            return nullptr;
+        }
+        std::memcpy(dst, data, size);
+        ++m_stats.uploads;
+        m_stats.bytes += size;
+        m_stats.copiedBytes += size;
+        return Unmap();
+    }
+
+    size_t begin;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (Allocate(size, begin)) {
+                // Released right away: only the fence keeps it alive
+                m_regions.push_back({begin, begin + size, 1, true});
+                m_open.push_back(m_firstRegion + m_regions.size() - 1);
+                ++m_stats.uploads;
+                m_stats.bytes += size;
+                m_stats.copiedBytes += size;
+                break;
+            }
+        }
+        // The GL calls reading the open ranges are already issued
+        CloseBatch();
+        if (m_batches.empty()) {
+            // Everything left is reserved by loaders that haven't handed it over yet
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.fallbacks;
+            return nullptr;
+        }
+        GLsync fence = m_batches.front().fence;
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.stalls;
+        }
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+        RetireBatch();
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+    std::memcpy(m_persistent + begin, data, size);
+    return reinterpret_cast<const void *>(begin);
+}
+
+void PixelUploadRing::CloseBatch()
+{
+    if (!m_open.empty()) {
+        m_batches.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(m_open)});
+        m_open.clear();
+    }
+}
+
+void PixelUploadRing::RetireBatch()
+{
+    glDeleteSync(m_batches.front().fence);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (uint64_t id : m_batches.front().regions) {
+            --m_regions[id - m_firstRegion].pending;
+        }
+        PopFreeRegions();
+    }
+    m_batches.pop_front();
+}
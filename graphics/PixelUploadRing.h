@@ -0,0 +1,115 @@
+#ifndef GRAPHICS_PIXELUPLOADRING_H
+#define GRAPHICS_PIXELUPLOADRING_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// Ring memory claimed by PixelUploadRing::Reserve()
+struct StagingRange
+{
+    explicit operator bool() const { return data != nullptr; }
+
+    unsigned char *                             data = nullptr;
+    size_t                                      size = 0;
+};
+
+/*
+ * Staging ring in a pixel unpack buffer, so texture uploads copy from
+ * GL-owned memory and the driver can transfer asynchronously.
+ * With ARB_buffer_storage the buffer is mapped persistently: any thread
+ * can Reserve() a range and write pixels straight into it, and Stage()
+ * then only hands the range to GL. Ranges are recycled once they are
+ * released and the fences of the GL calls reading them have signalled.
+ * Otherwise the buffer is orphaned when the ring wraps and Stage() copies
+ * on the GL thread. Everything but Reserve() and Release() is GL thread
+ * only.
+ */
+class PixelUploadRing
+{
+public:
+    struct Stats
+    {
+        uint64_t                                uploads = 0;
+        uint64_t                                bytes = 0;
+        uint64_t                                reservedBytes = 0; // written by Reserve() callers
+        uint64_t                                copiedBytes = 0;   // copied by Stage()
+        uint64_t                                stalls = 0;    // waits for the GPU to free a range
+        uint64_t                                fallbacks = 0; // didn't fit into the ring
+        double                                  seconds = 0.0;
+    };
+
+    PixelUploadRing(size_t size);
+    PixelUploadRing(const PixelUploadRing &other) = delete;
+    ~PixelUploadRing();
+
+    bool IsPersistent() const;
+
+    // Any thread. Empty if the ring isn't persistent or has no free range of size bytes now
+    StagingRange Reserve(size_t size);
+    // The range won't be passed to Stage() again; it is recycled after its GL reads complete
+    void Release(const StagingRange &range);
+
+    /*
+     * Returns the pointer argument for glTex(Sub)Image reading size bytes
+     * at data and binds the ring to GL_PIXEL_UNPACK_BUFFER. data inside a
+     * reserved range is used in place, anything else is copied into the
+     * ring. nullptr means upload from client memory instead.
+     */
+    const void *Stage(const void *data, size_t size);
+    // Fences the ranges read by the GL calls issued since the last Finish and unbinds the buffer
+    void Finish();
+    // Recycles the ranges whose fences have signalled, without waiting
+    void Recycle();
+
+    Stats GetStats() const;
+    void PrintStats() const;
+
+private:
+    struct Region
+    {
+        size_t                                  begin;
+        size_t                                  end;
+        unsigned                                pending = 0;   // open or fenced batches reading it
+        bool                                    released = false;
+    };
+
+    // Regions read by the GL calls issued before one fence
+    struct Batch
+    {
+        GLsync                                  fence;
+        std::vector<uint64_t>                   regions;
+    };
+
+    // Orphaning path
+    void *Map(size_t size);
+    const void *Unmap();
+
+    // Persistent path, called with m_mutex held
+    bool Allocate(size_t size, size_t &begin);
+    Region *FindRegion(const void *data, uint64_t &id);
+    void PopFreeRegions();
+
+    const void *StageCopy(const void *data, size_t size);
+    void CloseBatch();
+    void RetireBatch();
+
+private:
+    GLuint                                      m_buffer = 0;
+    size_t                                      m_size;
+    size_t                                      m_head = 0;
+    size_t                                      m_mapBegin = 0;
+    unsigned char *                             m_persistent = nullptr;
+    std::deque<Batch>                           m_batches;
+    std::vector<uint64_t>                       m_open;
+
+    mutable std::mutex                          m_mutex;
+    std::deque<Region>                          m_regions;     // in ring order, oldest first
+    uint64_t                                    m_firstRegion = 0; // id of m_regions.front()
+    Stats                                       m_stats;
+};
+
+#endif
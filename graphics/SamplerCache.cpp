@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <iostream>
+
+#include "SamplerCache.h"
+
+bool SamplerDesc::operator==(const SamplerDesc &other) const
+{
+    return minFilter == other.minFilter && magFilter == other.magFilter &&
+            wrapS == other.wrapS && wrapT == other.wrapT && anisotropy == other.anisotropy;
+}
+
+SamplerCache::~SamplerCache()
+{
+    Clear();
+}
+
+GLuint SamplerCache::Get(const SamplerDesc &desc)
+{
+    SamplerDesc key = desc;
+    key.anisotropy = std::clamp(desc.anisotropy, 1.0f, GetMaxAnisotropy());
+    for (const auto &sampler : m_samplers) {
+        if (sampler.first == key) {
+            return sampler.second;
+        }
+    }
+
+    GLuint id;
+    glGenSamplers(1, &id);
+    glSamplerParameteri(id, GL_TEXTURE_MIN_FILTER, key.minFilter);
+    glSamplerParameteri(id, GL_TEXTURE_MAG_FILTER, key.magFilter);
+    glSamplerParameteri(id, GL_TEXTURE_WRAP_S, key.wrapS);
+    glSamplerParameteri(id, GL_TEXTURE_WRAP_T, key.wrapT);
+    if (key.anisotropy > 1.0f) {
+        glSamplerParameterf(id, GL_TEXTURE_MAX_ANISOTROPY, key.anisotropy);
+    }
+    m_samplers.emplace_back(key, id);
+    return id;
+}
+
+void SamplerCache::Bind(GLuint unit, GLuint sampler)
+{
+    if (unit >= m_bound.size()) {
+        m_bound.resize(unit + 1, 0);
+    }
+    if (m_bound[unit] == sampler) {
+        ++m_stats.skipped;
+        return;
+    }
+    glBindSampler(unit, sampler);
+    m_bound[unit] = sampler;
+    ++m_stats.binds;
+}
+
+void SamplerCache::Bind(GLuint unit, const SamplerDesc &desc)
+{
+    Bind(unit, Get(desc));
+}
+
+void SamplerCache::Clear()
+{
+    for (const auto &sampler : m_samplers) {
+        glDeleteSamplers(1, &sampler.second);
+    }
+    m_samplers.clear();
+    m_bound.clear();
+}
+
+size_t SamplerCache::GetSamplerCount() const
+{
+    return m_samplers.size();
+}
+
+const SamplerCache::Stats &SamplerCache::GetStats() const
+{
+    return m_stats;
+}
+
+void SamplerCache::PrintStats() const
+{
+    std::cout << "Samplers: " << m_samplers.size() << " objects, " << m_stats.binds <<
+            " binds, " << m_stats.skipped << " redundant binds skipped" << std::endl;
+}
+
+float SamplerCache::GetMaxAnisotropy()
+{
+    static float maxAnisotropy = 0.0f;
+    if (maxAnisotropy == 0.0f) {
+        maxAnisotropy = 1.0f;
+        if (GLEW_ARB_texture_filter_anisotropic || GLEW_EXT_texture_filter_anisotropic) {
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAnisotropy);
+        }
+    }
+    return maxAnisotropy;
+}
@@ -0,0 +1,59 @@
+#ifndef GRAPHICS_SAMPLERCACHE_H
+#define GRAPHICS_SAMPLERCACHE_H
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct SamplerDesc
+{
+    bool operator==(const SamplerDesc &other) const;
+
+    GLenum                                      minFilter = GL_LINEAR_MIPMAP_LINEAR;
+    GLenum                                      magFilter = GL_LINEAR;
+    GLenum                                      wrapS = GL_REPEAT;
+    GLenum                                      wrapT = GL_REPEAT;
+    float                                       anisotropy = 1.0; // clamped to the driver's maximum
+};
+
+/*
+ * Sampler objects shared by every texture with the same description.
+ * Samplers override the sampling state stored in texture objects, so
+ * textures no longer carry wrap or filter parameters. Bind() remembers
+ * the sampler per unit and skips redundant glBindSampler calls.
+ * GL thread only.
+ */
+class SamplerCache
+{
+public:
+    struct Stats
+    {
+        uint64_t                                binds = 0;
+        uint64_t                                skipped = 0;
+    };
+
+    SamplerCache() = default;
+    SamplerCache(const SamplerCache &other) = delete;
+    ~SamplerCache();
+
+    GLuint Get(const SamplerDesc &desc);
+    void Bind(GLuint unit, GLuint sampler);
+    void Bind(GLuint unit, const SamplerDesc &desc);
+    // Deletes every sampler, ids from Get() become invalid
+    void Clear();
+
+    size_t GetSamplerCount() const;
+    const Stats &GetStats() const;
+    void PrintStats() const;
+
+    // 1 without anisotropic filtering support
+    static float GetMaxAnisotropy();
+
+private:
+    std::vector<std::pair<SamplerDesc, GLuint>> m_samplers; // few, searched linearly
+    std::vector<GLuint>                         m_bound;    // per texture unit
+    Stats                                       m_stats;
+};
+
+#endif
@@ -1,36 +1,127 @@
 #include <GL/glew.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <fstream>
-#include <sstream>
 #include <iostream>
+#include <iterator>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "AssetCache.h"
+#include "MappedFile.h"
 #include "Shader.h"
+#include "UniformBlocks.h"
 
 Shader *Shader::m_curUsed = nullptr;
+Shader::Stats Shader::m_stats;
+AssetCache *Shader::m_binaryCache = nullptr;
 
-Shader::Shader(const std::string &vertPath, const std::string &fragPath)
+static double SecondsSince(std::chrono::steady_clock::time_point start)
 {
-    Load(vertPath, fragPath);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// By UniformId
+static const char *const UNIFORM_NAMES[] = {
+    "modelTransform",
+    "fullTransform",
+    "octNormals",
+    "posScale",
+    "posOffset",
+    "shadowMap"
+};
+static_assert(sizeof(UNIFORM_NAMES) / sizeof(UNIFORM_NAMES[0]) == UNIFORM_LAST,
+        "a name for every UniformId");
+
+// By UniformBlockBinding
+static const char *const UNIFORM_BLOCK_NAMES[] = {
+    "Frame",
+    "Light",
+    "Material"
+};
+static_assert(sizeof(UNIFORM_BLOCK_NAMES) / sizeof(UNIFORM_BLOCK_NAMES[0]) == BLOCK_LAST,
+        "a name for every UniformBlockBinding");
+
+Shader::Shader(const std::string &vertPath, const std::string &fragPath) :
+    m_vertPath(vertPath),
+    m_fragPath(fragPath)
+{
+    QueryUniforms();
+    StartBuild();
 }
 
 Shader::Shader(Shader &&other) :
     m_id(other.m_id),
+    m_vertPath(std::move(other.m_vertPath)),
+    m_fragPath(std::move(other.m_fragPath)),
+    m_build(std::move(other.m_build)),
+    m_attribMask(other.m_attribMask),
     m_uniLocation(other.m_uniLocation)
 {
+    std::copy(std::begin(other.m_uniforms), std::end(other.m_uniforms), m_uniforms);
+    std::memcpy(m_values, other.m_values, sizeof(m_values));
+    std::copy(std::begin(other.m_valueSet), std::end(other.m_valueSet), m_valueSet);
     other.m_id = 0;
+    other.m_build = PendingBuild();
 }
 
 Shader::~Shader()
 {
+    CancelBuild();
     if (m_id) {
         glDeleteProgram(m_id);
     }
 }
 
+bool Shader::Poll()
+{
+    if (!m_build.program || !IsBuildComplete()) {
+        return false;
+    }
+    bool fromBinary = m_build.fromBinary;
+    GLuint id = FinishBuild();
+    if (!id) {
+        if (fromBinary) {
+            ++m_stats.binaryRejects;
+            StartBuild(false);
+        } else if (m_id) {
+            std::cerr << "Keeping the previous program for " << m_vertPath << ", " <<
+                    m_fragPath << std::endl;
+        }
+        return false;
+    }
+    if (m_id) {
+        glDeleteProgram(m_id);
+    }
+    m_id = id;
+    m_uniLocation.clear();
+    m_attribMask = 0;
+    QueryAttributes();
+    BindUniformBlocks();
+    QueryUniforms();
+    if (IsUsed()) {
+        m_curUsed = nullptr;
+        Use();
+    }
+    return true;
+}
+
+bool Shader::IsReady() const
+{
+    return m_id != 0;
+}
+
+void Shader::Reload()
+{
+    CancelBuild();
+    StartBuild();
+}
+
 void Shader::Use()
 {
     if (!IsUsed()) {
@@ -52,8 +143,98 @@ bool Shader::IsUsed() const
     return m_curUsed == this;
 }
 
+unsigned Shader::GetAttribMask() const
+{
+    return m_attribMask;
+}
+
+GLint Shader::GetUniLocation(UniformId id) const
+{
+    return m_uniforms[id];
+}
+
+void Shader::SetUniform(UniformId id, GLint val)
+{
+    if (IsShadowed(id, val)) {
+        return;
+    }
+    Use();
+    glUniform1i(m_uniforms[id], val);
+}
+
+void Shader::SetUniform(UniformId id, const glm::vec3 &val)
+{
+    if (IsShadowed(id, val)) {
+        return;
+    }
+    Use();
+    glUniform3fv(m_uniforms[id], 1, glm::value_ptr(val));
+}
+
+void Shader::SetUniform(UniformId id, const glm::vec4 &val)
+{
+    if (IsShadowed(id, val)) {
+        return;
+    }
+    Use();
+    glUniform4fv(m_uniforms[id], 1, glm::value_ptr(val));
+}
+
+void Shader::SetUniform(UniformId id, const glm::mat4 &val)
+{
+    if (IsShadowed(id, val)) {
+        return;
+    }
+    Use();
+    glUniformMatrix4fv(m_uniforms[id], 1, GL_FALSE, glm::value_ptr(val));
+}
+
+const Shader::Stats &Shader::GetStats()
+{
+    return m_stats;
+}
+
+void Shader::PrintStats()
+{
+    std::cout << "Uniforms: " << m_stats.calls << " set by id, " << m_stats.redundant <<
+            " redundant and " << m_stats.unused << " unused skipped" << std::endl;
+    std::cout << "Programs: " << m_stats.compiles << " compiled, " <<
+            m_stats.compileSeconds * 1000.0 << " ms on the GL thread, " <<
+            m_stats.compileWallSeconds * 1000.0 << " ms wall; " << m_stats.binaryLoads <<
+            " loaded from binaries, " << m_stats.binarySeconds * 1000.0 <<
+            " ms on the GL thread, " << m_stats.binaryWallSeconds * 1000.0 << " ms wall; " <<
+            m_stats.binaryRejects << " binaries rejected" << std::endl;
+}
+
+void Shader::SetBinaryCache(AssetCache *cache)
+{
+    m_binaryCache = cache;
+}
+
+template <typename T>
+bool Shader::IsShadowed(UniformId id, const T &val)
+{
+    static_assert(sizeof(T) <= sizeof(m_values[0]), "uniform value too large to shadow");
+    ++m_stats.calls;
+    if (m_uniforms[id] == -1) {
+        ++m_stats.unused;
+        return true;
+    }
+    if (m_valueSet[id] && std::memcmp(m_values[id], &val, sizeof(T)) == 0) {
+        ++m_stats.redundant;
+        return true;
+    }
+    std::memcpy(m_values[id], &val, sizeof(T));
+    m_valueSet[id] = true;
+    return false;
+}
+
 GLint Shader::GetUniLocation(const std::string &uniName)
 {
+    // Still building
+    if (!m_id) {
+        return -1;
+    }
     if (auto it = m_uniLocation.find(uniName); it != m_uniLocation.end()) {
         return it->second;
     } else {
@@ -69,70 +250,265 @@ GLint Shader::GetUniLocation(const std::string &uniName)
 
 void Shader::SetUniform(const std::string &uniName, GLint val)
 {
+    GLint location = GetUniLocation(uniName);
+    ForgetValue(location);
     Use();
-    glUniform1i(GetUniLocation(uniName), val);
+    glUniform1i(location, val);
 }
 
 void Shader::SetUniform(const std::string &uniName, const glm::vec3 &val)
 {
+    GLint location = GetUniLocation(uniName);
+    ForgetValue(location);
     Use();
-    glUniform3fv(GetUniLocation(uniName), 1, glm::value_ptr(val));
+    glUniform3fv(location, 1, glm::value_ptr(val));
 }
 
 void Shader::SetUniform(const std::string &uniName, const glm::vec4 &val)
 {
+    GLint location = GetUniLocation(uniName);
+    ForgetValue(location);
     Use();
-    glUniform4fv(GetUniLocation(uniName), 1, glm::value_ptr(val));
+    glUniform4fv(location, 1, glm::value_ptr(val));
 }
 
 void Shader::SetUniform(const std::string &uniName, const glm::mat4 &val)
 {
+    GLint location = GetUniLocation(uniName);
+    ForgetValue(location);
     Use();
-    glUniformMatrix4fv(GetUniLocation(uniName), 1, GL_FALSE, glm::value_ptr(val));
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(val));
 }
 
-void Shader::Load(const std::string &vertPath, const std::string &fragPath)
+/*
+ * Nothing here waits for the driver: statuses are read in FinishBuild, so
+ * every program is submitted before the first is checked, and drivers with
+ * KHR_parallel_shader_compile build them on their own threads meanwhile.
+ */
+void Shader::StartBuild(bool useBinary)
 {
+    static bool threadsSet = false;
+    if (!threadsSet && GLEW_KHR_parallel_shader_compile) {
+        // As many as the driver likes
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        threadsSet = true;
+    }
+
+    m_build = PendingBuild();
+    m_build.start = std::chrono::steady_clock::now();
+    if (m_binaryCache && GLEW_ARB_get_program_binary) {
+        m_build.key = m_binaryCache->MakeKey({m_vertPath, m_fragPath},
+                "program " + GetDriverString());
+    }
+    if (useBinary && !m_build.key.empty() && LoadBinary()) {
+        m_build.blockingSeconds = SecondsSince(m_build.start);
+        return;
+    }
+
     std::string vCode, fCode;
-    std::ifstream vFile, fFile;
-    try {
-        vFile.open(vertPath);
-        fFile.open(fragPath);
-        std::stringstream vStream, fStream;
-        vStream << vFile.rdbuf();
-        fStream << fFile.rdbuf();
-        vFile.close();
-        fFile.close();
-        vCode = vStream.str();
-        fCode = fStream.str();
-    } catch (std::ifstream::failure &e) {
+    MappedFile vFile(m_vertPath), fFile(m_fragPath);
+    if (vFile.IsOpen() && fFile.IsOpen()) {
+        vCode.assign(reinterpret_cast<const char *>(vFile.Data()), vFile.Size());
+        fCode.assign(reinterpret_cast<const char *>(fFile.Data()), fFile.Size());
+    } else {
         std::cerr << "Error while opening shader source file: " <<
-                std::endl;
-        std::cerr << e.what() << std::endl;
+                (vFile.IsOpen() ? m_fragPath : m_vertPath) << std::endl;
     }
 
-    GLuint vId, fId;
-    vId = CompileShader(vCode, GL_VERTEX_SHADER);
-    fId = CompileShader(fCode, GL_FRAGMENT_SHADER);
+    m_build.vert = CompileShader(vCode, GL_VERTEX_SHADER);
+    m_build.frag = CompileShader(fCode, GL_FRAGMENT_SHADER);
 
-    m_id = glCreateProgram();
+    m_build.program = glCreateProgram();
+    glAttachShader(m_build.program, m_build.vert);
+    glAttachShader(m_build.program, m_build.frag);
+    if (!m_build.key.empty()) {
+        glProgramParameteri(m_build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(m_build.program);
+    m_build.blockingSeconds = SecondsSince(m_build.start);
+}
 
-    glAttachShader(m_id, vId);
-    glAttachShader(m_id, fId);
-    glLinkProgram(m_id);
+/*
+ * Blob layout: the binary format enum, then the binary. A driver update
+ * changes the key, but a driver may still reject a binary it made.
+ */
+bool Shader::LoadBinary()
+{
+    std::string path;
+    if (!m_binaryCache->Lookup(m_build.key, path)) {
+        return false;
+    }
+    MappedFile file(path);
+    if (!file.IsOpen() || file.Size() <= sizeof(GLenum)) {
+        return false;
+    }
+    GLenum format;
+    std::memcpy(&format, file.Data(), sizeof(format));
 
+    m_build.program = glCreateProgram();
+    glProgramBinary(m_build.program, format,
+            static_cast<const unsigned char *>(file.Data()) + sizeof(format),
+            file.Size() - sizeof(format));
+    m_build.fromBinary = true;
+    return true;
+}
+
+// Without the extension FinishBuild blocks on the link status instead
+bool Shader::IsBuildComplete() const
+{
+    if (!GLEW_KHR_parallel_shader_compile) {
+        return true;
+    }
+    GLint complete;
+    glGetProgramiv(m_build.program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
+
+GLuint Shader::FinishBuild()
+{
+    auto finishStart = std::chrono::steady_clock::now();
+    PendingBuild build = std::move(m_build);
+    m_build = PendingBuild();
+
+    GLuint id = build.program;
+    if (!build.fromBinary) {
+        CheckShader(build.vert, GL_VERTEX_SHADER);
+        CheckShader(build.frag, GL_FRAGMENT_SHADER);
+        glDeleteShader(build.vert);
+        glDeleteShader(build.frag);
+    }
     GLint result;
-    glGetProgramiv(m_id, GL_LINK_STATUS, &result);
+    glGetProgramiv(id, GL_LINK_STATUS, &result);
     if (result != GL_TRUE) {
-        char message[1024];
-        glGetProgramInfoLog(m_id, sizeof(message), nullptr, message);
-        std::cerr << "Failed to link shader: " << std::endl;
-        std::cerr << vertPath << std::endl << fragPath << std::endl;
-        std::cerr << message << std::endl;
+        if (!build.fromBinary) {
+            char message[1024];
+            glGetProgramInfoLog(id, sizeof(message), nullptr, message);
+            std::cerr << "Failed to link shader: " << std::endl;
+            std::cerr << m_vertPath << std::endl << m_fragPath << std::endl;
+            std::cerr << message << std::endl;
+        }
+        glDeleteProgram(id);
+        return 0;
     }
 
-    glDeleteShader(vId);
-    glDeleteShader(fId);
+    if (!build.fromBinary && !build.key.empty()) {
+        StoreBinary(build.key, id);
+    }
+    std::chrono::duration<double> wall = finishStart - build.start;
+    double blocking = build.blockingSeconds + SecondsSince(finishStart);
+    if (build.fromBinary) {
+        ++m_stats.binaryLoads;
+        m_stats.binarySeconds += blocking;
+        m_stats.binaryWallSeconds += wall.count();
+    } else {
+        ++m_stats.compiles;
+        m_stats.compileSeconds += blocking;
+        m_stats.compileWallSeconds += wall.count();
+    }
+    std::cout << "Built shader " << m_vertPath << ", " << m_fragPath <<
+            (build.fromBinary ? " from a binary" : "") << ": " << blocking * 1000.0 <<
+            " ms on the GL thread, complete within " << wall.count() * 1000.0 << " ms" <<
+            std::endl;
+    return id;
+}
+
+void Shader::CancelBuild()
+{
+    if (m_build.program) {
+        glDeleteShader(m_build.vert);
+        glDeleteShader(m_build.frag);
+        glDeleteProgram(m_build.program);
+    }
+    m_build = PendingBuild();
+}
+
+void Shader::StoreBinary(const std::string &key, GLuint id)
+{
+    GLint length = 0;
+    glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(id, length, &length, &format, binary.data());
+
+    std::string path = m_binaryCache->GetTempPath(key);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Could not create program binary: " << path << std::endl;
+        return;
+    }
+    file.write(reinterpret_cast<const char *>(&format), sizeof(format));
+    file.write(binary.data(), length);
+    file.close();
+    if (file) {
+        m_binaryCache->Commit(key);
+    } else {
+        m_binaryCache->Discard(key);
+    }
+}
+
+const std::string &Shader::GetDriverString()
+{
+    static std::string driver;
+    if (driver.empty()) {
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const char *value = reinterpret_cast<const char *>(glGetString(name));
+            driver += value ? value : "";
+            driver += '\n';
+        }
+    }
+    return driver;
+}
+
+void Shader::QueryAttributes()
+{
+    GLint count;
+    glGetProgramiv(m_id, GL_ACTIVE_ATTRIBUTES, &count);
+    for (GLint i = 0; i < count; ++i) {
+        char name[256];
+        GLint size;
+        GLenum type;
+        glGetActiveAttrib(m_id, i, sizeof(name), nullptr, &size, &type, name);
+        GLint location = glGetAttribLocation(m_id, name);
+        if (location >= 0) {
+            m_attribMask |= 1u << location;
+        }
+    }
+}
+
+// Blocks a program does not declare are skipped
+void Shader::BindUniformBlocks()
+{
+    for (int i = 0; i < BLOCK_LAST; ++i) {
+        GLuint index = glGetUniformBlockIndex(m_id, UNIFORM_BLOCK_NAMES[i]);
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(m_id, index, i);
+        }
+    }
+}
+
+// A uniform that has an id was set by name
+void Shader::ForgetValue(GLint location)
+{
+    for (int i = 0; i < UNIFORM_LAST; ++i) {
+        if (location != -1 && m_uniforms[i] == location) {
+            m_valueSet[i] = false;
+        }
+    }
+}
+
+/*
+ * Not every program uses every UniformId, so a missing one is not reported.
+ * A new program starts from default values, so the shadow is cleared too.
+ */
+void Shader::QueryUniforms()
+{
+    for (int i = 0; i < UNIFORM_LAST; ++i) {
+        m_uniforms[i] = m_id ? glGetUniformLocation(m_id, UNIFORM_NAMES[i]) : -1;
+        m_valueSet[i] = false;
+    }
 }
 
 GLuint Shader::CompileShader(const std::string& source, GLenum type)
@@ -141,7 +517,11 @@ GLuint Shader::CompileShader(const std::string& source, GLenum type)
     const char *src = source.c_str();
     glShaderSource(id, 1, &src, nullptr);
     glCompileShader(id);
+    return id;
+}
 
+void Shader::CheckShader(GLuint id, GLenum type)
+{
     GLint result;
     glGetShaderiv(id, GL_COMPILE_STATUS, &result);
     if (result == GL_FALSE) {
@@ -152,9 +532,5 @@ GLuint Shader::CompileShader(const std::string& source, GLenum type)
                 (type == GL_VERTEX_SHADER ? "vertex" : "fragment") <<
                 std::endl;
         std::cerr << message << std::endl;
-        glDeleteShader(id);
-        return 0;
     }
-
-    return id;
 }
@@ -2,36 +2,152 @@
 #define GRAPHICS_SHADER_H
 
 #include <GL/glew.h>
+#include <chrono>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <glm/glm.hpp>
 
+class AssetCache;
+
+/*
+ * Uniforms set per draw or per frame. Their locations are looked up once per
+ * link, so setting one is an array index. Names are in Shader.cpp.
+ */
+enum UniformId {
+    UNIFORM_MODEL_TRANSFORM = 0,
+    UNIFORM_FULL_TRANSFORM,
+    UNIFORM_OCT_NORMALS,
+    UNIFORM_POS_SCALE,
+    UNIFORM_POS_OFFSET,
+    UNIFORM_SHADOW_MAP,
+    UNIFORM_LAST
+};
+
 class Shader
 {
 public:
+    // Starts building the program, see Poll
     Shader(const std::string &vertPath, const std::string &fragpath);
     Shader(const Shader &other) = delete;
     Shader(Shader &&other);
     ~Shader();
 
+    /*
+     * Builds do not wait for the driver. Poll finishes the one in flight
+     * once it is done and returns true if its program took over; uniform
+     * values live in the program, so the caller sets them again then.
+     */
+    bool Poll();
+    bool IsReady() const;
+    // Rebuilds from the source files; on failure the current program stays in use
+    void Reload();
+
     void Use();
     void Unuse();
     bool IsUsed() const;
 
+    // Bit per attribute location the program reads
+    unsigned GetAttribMask() const;
+
+    /*
+     * The values set by id are shadowed: a call with the bytes the program
+     * already holds, or for a uniform it does not use, makes no GL call.
+     */
+    // -1 if the program does not use it
+    GLint GetUniLocation(UniformId id) const;
+    void SetUniform(UniformId id, GLint val);
+    void SetUniform(UniformId id, const glm::vec3 &val);
+    void SetUniform(UniformId id, const glm::vec4 &val);
+    void SetUniform(UniformId id, const glm::mat4 &val);
+
+    // By name, for uniforms set rarely
     GLint GetUniLocation(const std::string &uniName);
     void SetUniform(const std::string &name, GLint val);
     void SetUniform(const std::string &name, const glm::vec3 &val);
     void SetUniform(const std::string &name, const glm::vec4 &val);
     void SetUniform(const std::string &name, const glm::mat4 &val);
-    
+
+    /*
+     * Linked programs are stored in the cache with glGetProgramBinary, keyed
+     * by the sources and the driver, and loaded from it on the next build.
+     * Needs ARB_get_program_binary; nullptr turns it off.
+     */
+    static void SetBinaryCache(AssetCache *cache);
+
+    struct Stats
+    {
+        // Uniforms set by id
+        uint64_t                                            calls = 0;
+        uint64_t                                            redundant = 0;
+        uint64_t                                            unused = 0;
+        /*
+         * Program builds. Seconds the GL thread spent in the build's GL
+         * calls, which is what parallel compiles cut, and wall time from
+         * submission until a Poll found it complete; Poll runs once a
+         * frame, so the latter includes whatever the app did meanwhile.
+         */
+        uint64_t                                            compiles = 0;
+        uint64_t                                            binaryLoads = 0;
+        uint64_t                                            binaryRejects = 0;
+        double                                              compileSeconds = 0.0;
+        double                                              binarySeconds = 0.0;
+        double                                              compileWallSeconds = 0.0;
+        double                                              binaryWallSeconds = 0.0;
+    };
+    // Over all shaders
+    static const Stats &GetStats();
+    static void PrintStats();
+
 private:
-    void Load(const std::string &vertPath, const std::string &fragPath);
+    // A program being linked, possibly on driver threads
+    struct PendingBuild
+    {
+        GLuint                                              program = 0;
+        GLuint                                              vert = 0;
+        GLuint                                              frag = 0;
+        std::string                                         key; // binary cache, empty if off
+        bool                                                fromBinary = false;
+        std::chrono::steady_clock::time_point               start;
+        double                                              blockingSeconds = 0.0; // in StartBuild
+    };
+
+    // From the binary cache, or compiled and linked from the sources
+    void StartBuild(bool useBinary = true);
+    // False on a miss
+    bool LoadBinary();
+    bool IsBuildComplete() const;
+    // The linked program, 0 on failure or if the driver rejects the binary
+    GLuint FinishBuild();
+    void CancelBuild();
+    static void StoreBinary(const std::string &key, GLuint id);
+    // Vendor, renderer and version: a binary is only valid for the driver that made it
+    static const std::string &GetDriverString();
     static GLuint CompileShader(const std::string &source, GLenum type);
+    // Reports a failed compile
+    static void CheckShader(GLuint id, GLenum type);
+    void QueryAttributes();
+    void QueryUniforms();
+    void BindUniformBlocks();
+    // True if the call can be dropped, otherwise records the value
+    template <typename T>
+    bool IsShadowed(UniformId id, const T &val);
+    void ForgetValue(GLint location);
 
 private:
     GLuint                                                  m_id = 0;
+    std::string                                             m_vertPath;
+    std::string                                             m_fragPath;
+    PendingBuild                                            m_build;
+    unsigned                                                m_attribMask = 0;
     std::unordered_map<std::string, int>                    m_uniLocation;
+    GLint                                                   m_uniforms[UNIFORM_LAST];
+    // Largest value is a mat4
+    float                                                   m_values[UNIFORM_LAST][16];
+    bool                                                    m_valueSet[UNIFORM_LAST];
     static Shader *                                         m_curUsed;
+    static Stats                                            m_stats;
+    static AssetCache *                                     m_binaryCache;
 };
 
 #endif
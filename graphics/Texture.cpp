@@ -2,47 +2,166 @@
 #include <string>
 #include <iostream>
 
-#define STB_IMAGE_IMPLEMENTATION
-#pragma GCC diagnostic ignored "-Wtype-limits"
-#include "../deps/stb_image.h"
-#pragma GCC diagnostic pop
-
+#include "BlockCompress.h"
+#include "GpuTracker.h"
+#include "MipChain.h"
 #include "Texture.h"
 
+namespace {
+
+// Through the ring if there is one and the level fits, from client memory otherwise
+const void *StageLevel(PixelUploadRing *ring, const void *data, size_t size)
+{
+    const void *staged = ring ? ring->Stage(data, size) : nullptr;
+    return staged ? staged : data;
+}
+
+std::vector<TextureLevel> FileLevels(const TextureFile &file)
+{
+    std::vector<TextureLevel> levels;
+    for (size_t i = 0; i < file.GetLevelCount(); ++i) {
+        levels.push_back(file.GetLevel(i));
+    }
+    return levels;
+}
+
+}
+
 Texture::Texture(const std::string &path)
 {
-    Load(path);
+    Image image;
+    DecodeImage(path, image);
+    Upload(image, BuildMipChain(image), nullptr);
+}
+
+Texture::Texture(const Image &image)
+{
+    Upload(image, BuildMipChain(image), nullptr);
+}
+
+Texture::Texture(const std::vector<Image> &levels, PixelUploadRing *ring)
+{
+    if (!levels.empty()) {
+        Upload(levels[0], std::vector<Image>(levels.begin() + 1, levels.end()), ring);
+    }
+}
+
+Texture::Texture(const TextureFile &file, PixelUploadRing *ring) :
+    Texture(file.GetFormat(), FileLevels(file), ring)
+{
+}
+
+Texture::Texture(uint32_t format, const std::vector<TextureLevel> &levels, PixelUploadRing *ring)
+{
+    if (levels.empty()) {
+        return;
+    }
+    Create(levels[0].width, levels[0].height);
+    UploadLevels(format, levels, ring);
+    if (ring) {
+        ring->Finish();
+    }
+    Unbind();
+    GpuTracker::Resize(GPU_OBJECT_TEXTURE, m_id, m_memorySize);
 }
 
 Texture::Texture(Texture &&other) :
     m_width(other.m_width),
     m_height(other.m_height),
-    m_id(other.m_id)
+    m_id(other.m_id),
+    m_memorySize(other.m_memorySize)
 {
     other.m_id = 0;
 }
 
-void Texture::Load(const std::string &path)
+Texture &Texture::operator=(Texture &&other)
 {
-    int channels_num;
-    stbi_set_flip_vertically_on_load(1);
-    unsigned char *image = stbi_load(path.c_str(), &m_width, &m_height, &channels_num, 4);
-
-    if (!image) {
-        std::cerr << "Failed to load image: " << path << std::endl;
+    if (this != &other) {
+        if (m_id) {
+            GpuTracker::Untrack(GPU_OBJECT_TEXTURE, m_id);
+            glDeleteTextures(1, &m_id);
+        }
+        m_width = other.m_width;
+        m_height = other.m_height;
+        m_id = other.m_id;
+        m_memorySize = other.m_memorySize;
+        other.m_id = 0;
     }
+    return *this;
+}
+
+// Generates the texture and leaves it bound. Sampling state comes from SamplerCache
+void Texture::Create(int width, int height)
+{
+    m_width = width;
+    m_height = height;
 
     glGenTextures(1, &m_id);
+    GPU_TRACK(GPU_OBJECT_TEXTURE, m_id, GPU_TEXTURE, 0, "texture");
     Bind();
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+}
+
+void Texture::UploadLevels(uint32_t format, const std::vector<TextureLevel> &levelData,
+        PixelUploadRing *ring)
+{
+    GLint levels = levelData.size();
+    if (levels > 1) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    }
 
-    glGenerateMipmap(GL_TEXTURE_2D);
+    if (format == KTX2_FORMAT_R8G8B8A8_UNORM) {
+        for (GLint i = 0; i < levels; ++i) {
+            const TextureLevel &level = levelData[i];
+            glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, level.width, level.height, 0, GL_RGBA,
+                    GL_UNSIGNED_BYTE, StageLevel(ring, level.data, level.size));
+            m_memorySize += level.size;
+        }
+    } else if (IsFormatSupported(format)) {
+        GLenum glFormat = GetCompressedFormat(format);
+        for (GLint i = 0; i < levels; ++i) {
+            const TextureLevel &level = levelData[i];
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, glFormat, level.width, level.height, 0,
+                    level.size, StageLevel(ring, level.data, level.size));
+            m_memorySize += level.size;
+        }
+    } else {
+        for (GLint i = 0; i < levels; ++i) {
+            const TextureLevel &level = levelData[i];
+            Image image;
+            if (!DecompressImage(level.data, level.width, level.height, format, image)) {
+                std::cerr << "Unsupported texture format: " << format << std::endl;
+                return;
+            }
+            glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, level.width, level.height, 0, GL_RGBA,
+                    GL_UNSIGNED_BYTE, StageLevel(ring, image.pixels.data(), image.pixels.size()));
+            m_memorySize += image.pixels.size();
+        }
+    }
+
+    if (levels == 1) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        m_memorySize = m_memorySize * 4 / 3;
+    }
+}
 
-    stbi_image_free(image);
+// Explicit levels: glGenerateMipmap runs synchronously on some drivers
+void Texture::Upload(const Image &base, const std::vector<Image> &mips, PixelUploadRing *ring)
+{
+    Create(base.width, base.height);
+    m_memorySize = base.pixels.size();
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+            base.pixels.empty() ? nullptr :
+            StageLevel(ring, base.pixels.data(), base.pixels.size()));
+    for (size_t i = 0; i < mips.size(); ++i) {
+        glTexImage2D(GL_TEXTURE_2D, i + 1, GL_RGBA8, mips[i].width, mips[i].height, 0, GL_RGBA,
+                GL_UNSIGNED_BYTE, StageLevel(ring, mips[i].pixels.data(), mips[i].pixels.size()));
+        m_memorySize += mips[i].pixels.size();
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mips.size());
+    if (ring) {
+        ring->Finish();
+    }
+    GpuTracker::Resize(GPU_OBJECT_TEXTURE, m_id, m_memorySize);
 
     Unbind();
 }
@@ -50,6 +169,7 @@ void Texture::Load(const std::string &path)
 Texture::~Texture()
 {
     if (m_id) {
+        GpuTracker::Untrack(GPU_OBJECT_TEXTURE, m_id);
         glDeleteTextures(1, &m_id);
     }
 }
@@ -64,3 +184,43 @@ void Texture::Unbind()
 {
     glBindTexture(GL_TEXTURE_2D, 0);
 }
+
+bool Texture::IsReady() const
+{
+    return m_id != 0;
+}
+
+// Including mip levels
+size_t Texture::GetMemorySize() const
+{
+    return m_memorySize;
+}
+
+bool Texture::IsFormatSupported(uint32_t format)
+{
+    switch (format) {
+        case KTX2_FORMAT_R8G8B8A8_UNORM:
+            return true;
+        case KTX2_FORMAT_BC1_RGBA_UNORM:
+        case KTX2_FORMAT_BC3_UNORM:
+            return GLEW_EXT_texture_compression_s3tc;
+        case KTX2_FORMAT_BC7_UNORM:
+            return GLEW_ARB_texture_compression_bptc;
+        default:
+            return false;
+    }
+}
+
+GLenum Texture::GetCompressedFormat(uint32_t format)
+{
+    switch (format) {
+        case KTX2_FORMAT_BC1_RGBA_UNORM:
+            return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case KTX2_FORMAT_BC3_UNORM:
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case KTX2_FORMAT_BC7_UNORM:
+            return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        default:
+            return GL_NONE;
+    }
+}
@@ -3,27 +3,53 @@
 
 #include <GL/glew.h>
 #include <string>
+#include <vector>
+
+#include "Image.h"
+#include "PixelUploadRing.h"
+#include "TextureFile.h"
 
 class Texture
 {
 public:
+    Texture() = default;
     Texture(const std::string &path);
+    // Mip levels are built on the calling thread
+    Texture(const Image &image);
+    // Base level first, followed by its mip chain
+    Texture(const std::vector<Image> &levels, PixelUploadRing *ring = nullptr);
+    // Block-compressed formats are decoded on the CPU if the driver lacks them
+    Texture(const TextureFile &file, PixelUploadRing *ring = nullptr);
+    // Levels in a KTX2 format, e.g. written into the ring by a loader thread
+    Texture(uint32_t format, const std::vector<TextureLevel> &levels,
+            PixelUploadRing *ring = nullptr);
     Texture(const Texture &other) = delete;
     Texture(Texture &&other);
     ~Texture();
 
+    Texture &operator=(Texture &&other);
+
     void Bind();
     void Unbind();
+    bool IsReady() const;
+    size_t GetMemorySize() const;
 
+    static bool IsFormatSupported(uint32_t format);
+    // GL internal format of a block-compressed KTX2 format, GL_NONE for others
+    static GLenum GetCompressedFormat(uint32_t format);
 
 private:
-    void Load(const std::string &path);
+    void Upload(const Image &base, const std::vector<Image> &mips, PixelUploadRing *ring);
+    void Create(int width, int height);
+    void UploadLevels(uint32_t format, const std::vector<TextureLevel> &levels,
+            PixelUploadRing *ring);
 
 private:
-    int m_width;
-    int m_height;
+    int m_width = 0;
+    int m_height = 0;
     GLuint m_id = 0;
+    size_t m_memorySize = 0;
 
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "BlockCompress.h"
+#include "GpuTracker.h"
+#include "Texture.h"
+#include "TextureArray.h"
+
+const TextureArray *TextureArray::m_curBound = nullptr;
+
+namespace {
+
+int LevelCount(int width, int height)
+{
+    int levels = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        ++levels;
+    }
+    return levels;
+}
+
+}
+
+TextureArray::TextureArray(int width, int height, int maxLayers, int baseLevel,
+        uint32_t format) :
+    m_width(width),
+    m_height(height),
+    m_levels(LevelCount(width, height)),
+    m_layers(maxLayers),
+    m_baseLevel(std::min(baseLevel, m_levels - 1)),
+    m_format(format)
+{
+    Allocate(1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+TextureArray::TextureArray(TextureArray &&other) :
+    m_id(other.m_id),
+    m_width(other.m_width),
+    m_height(other.m_height),
+    m_levels(other.m_levels),
+    m_layers(other.m_layers),
+    m_capacity(other.m_capacity),
+    m_baseLevel(other.m_baseLevel),
+    m_format(other.m_format),
+    m_sources(std::move(other.m_sources)),
+    m_users(std::move(other.m_users))
+{
+    other.m_id = 0;
+    if (m_curBound == &other) {
+        m_curBound = nullptr;
+    }
+}
+
+TextureArray::~TextureArray()
+{
+    if (m_curBound == this) {
+        m_curBound = nullptr;
+    }
+    if (m_id) {
+        GpuTracker::Untrack(GPU_OBJECT_TEXTURE, m_id);
+        glDeleteTextures(1, &m_id);
+    }
+}
+
+int TextureArray::AddLayer(std::shared_ptr<const std::vector<Image>> levels,
+        PixelUploadRing *ring, const std::vector<TextureLevel> &staged)
+{
+    if (IsFull()) {
+        return -1;
+    }
+    bool matches = levels->size() == size_t(m_levels) && levels->front().width == m_width &&
+            levels->front().height == m_height;
+    for (int i = 0; matches && i < m_levels; ++i) {
+        matches = (*levels)[i].pixels.size() == GetLayerLevelSize(i);
+    }
+    if (!matches) {
+        std::cerr << "Texture array layer does not match the array size" << std::endl;
+        return -1;
+    }
+
+    int layer = std::find(m_sources.begin(), m_sources.end(), nullptr) - m_sources.begin();
+    if (layer == m_capacity) {
+        Grow(ring);
+    }
+    if (layer == int(m_sources.size())) {
+        m_sources.emplace_back();
+        m_users.emplace_back();
+    }
+    m_sources[layer] = std::move(levels);
+    m_users[layer] = 1;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+    m_curBound = nullptr;
+    for (int i = m_baseLevel; i < m_levels; ++i) {
+        UploadLevel(i, layer, ring, staged.empty() ? nullptr : staged[i].data);
+    }
+    if (ring) {
+        ring->Finish();
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return layer;
+}
+
+void TextureArray::RetainLayer(int layer)
+{
+    if (layer >= 0 && layer < int(m_sources.size()) && m_sources[layer]) {
+        ++m_users[layer];
+    }
+}
+
+void TextureArray::RemoveLayer(int layer)
+{
+    if (layer >= 0 && layer < int(m_sources.size()) && m_sources[layer] &&
+            --m_users[layer] == 0) {
+        m_sources[layer].reset();
+    }
+}
+
+bool TextureArray::StreamIn(PixelUploadRing *ring)
+{
+    if (m_baseLevel == 0) {
+        return false;
+    }
+    int level = m_baseLevel - 1;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+    m_curBound = nullptr;
+    DefineLevel(level, std::max(1, m_width >> level), std::max(1, m_height >> level),
+            m_capacity);
+    for (size_t layer = 0; layer < m_sources.size(); ++layer) {
+        if (m_sources[layer]) {
+            UploadLevel(level, layer, ring);
+        }
+    }
+    if (ring) {
+        ring->Finish();
+    }
+    m_baseLevel = level;
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, m_baseLevel);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    GpuTracker::Resize(GPU_OBJECT_TEXTURE, m_id, GetMemorySize());
+    return true;
+}
+
+// A zero-sized image releases the level's storage
+bool TextureArray::Evict()
+{
+    if (m_baseLevel == m_levels - 1) {
+        return false;
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+    m_curBound = nullptr;
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, m_baseLevel + 1);
+    DefineLevel(m_baseLevel, 0, 0, 0);
+    ++m_baseLevel;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    GpuTracker::Resize(GPU_OBJECT_TEXTURE, m_id, GetMemorySize());
+    return true;
+}
+
+/*
+ * Creates storage for layers layers and leaves it bound. Levels above the
+ * base level are left undefined, which BASE_LEVEL keeps from making the
+ * texture incomplete.
+ */
+void TextureArray::Allocate(int layers)
+{
+    glGenTextures(1, &m_id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+    for (int i = m_baseLevel; i < m_levels; ++i) {
+        DefineLevel(i, std::max(1, m_width >> i), std::max(1, m_height >> i), layers);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, m_baseLevel);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, m_levels - 1);
+    m_capacity = layers;
+    GPU_TRACK(GPU_OBJECT_TEXTURE, m_id, GPU_TEXTURE, GetMemorySize(), "texture array");
+    m_curBound = nullptr;
+}
+
+// Expects the array to be bound. Leaves the level's contents undefined
+void TextureArray::DefineLevel(int level, int width, int height, int layers)
+{
+    if (m_format == KTX2_FORMAT_R8G8B8A8_UNORM) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, width, height, layers, 0, GL_RGBA,
+                GL_UNSIGNED_BYTE, nullptr);
+    } else {
+        glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, Texture::GetCompressedFormat(m_format),
+                width, height, layers, 0, CompressedSize(width, height, m_format) * layers, nullptr);
+    }
+}
+
+// Doubles the storage. Resident levels are copied on the GPU, or uploaded again from the sources
+void TextureArray::Grow(PixelUploadRing *ring)
+{
+    GLuint old = m_id;
+    int oldCapacity = m_capacity;
+    Allocate(std::min(m_layers, m_capacity * 2));
+    if (GLEW_ARB_copy_image) {
+        for (int i = m_baseLevel; i < m_levels; ++i) {
+            glCopyImageSubData(old, GL_TEXTURE_2D_ARRAY, i, 0, 0, 0,
+                    m_id, GL_TEXTURE_2D_ARRAY, i, 0, 0, 0,
+                    std::max(1, m_width >> i), std::max(1, m_height >> i), oldCapacity);
+        }
+    } else {
+        for (size_t layer = 0; layer < m_sources.size(); ++layer) {
+            if (!m_sources[layer]) {
+                continue;
+            }
+            for (int i = m_baseLevel; i < m_levels; ++i) {
+                UploadLevel(i, layer, ring);
+            }
+        }
+    }
+    GpuTracker::Untrack(GPU_OBJECT_TEXTURE, old);
+    glDeleteTextures(1, &old);
+}
+
+// Expects the array to be bound. staged is the level's copy in ring memory, if any
+void TextureArray::UploadLevel(int level, int layer, PixelUploadRing *ring,
+        const unsigned char *staged)
+{
+    const Image &image = (*m_sources[layer])[level];
+    const void *pixels = ring ? ring->Stage(staged ? staged : image.pixels.data(),
+            image.pixels.size()) : nullptr;
+    if (m_format == KTX2_FORMAT_R8G8B8A8_UNORM) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, image.width, image.height, 1,
+                GL_RGBA, GL_UNSIGNED_BYTE, pixels ? pixels : image.pixels.data());
+    } else {
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, image.width,
+                image.height, 1, Texture::GetCompressedFormat(m_format), image.pixels.size(),
+                pixels ? pixels : image.pixels.data());
+    }
+}
+
+// Texture arrays go to unit 2, after the 2D texture and the shadow map
+void TextureArray::Bind() const
+{
+    if (m_curBound == this) {
+        return;
+    }
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_id);
+    glActiveTexture(GL_TEXTURE0);
+    m_curBound = this;
+}
+
+int TextureArray::GetWidth() const
+{
+    return m_width;
+}
+
+int TextureArray::GetHeight() const
+{
+    return m_height;
+}
+
+int TextureArray::GetLevelCount() const
+{
+    return m_levels;
+}
+
+uint32_t TextureArray::GetFormat() const
+{
+    return m_format;
+}
+
+int TextureArray::GetBaseLevel() const
+{
+    return m_baseLevel;
+}
+
+bool TextureArray::IsFull() const
+{
+    return m_sources.size() >= size_t(m_layers) &&
+            std::find(m_sources.begin(), m_sources.end(), nullptr) == m_sources.end();
+}
+
+bool TextureArray::IsEmpty() const
+{
+    return std::find_if(m_sources.begin(), m_sources.end(),
+            [](const auto &source) { return source != nullptr; }) == m_sources.end();
+}
+
+size_t TextureArray::GetMemorySize() const
+{
+    size_t size = 0;
+    for (int i = m_baseLevel; i < m_levels; ++i) {
+        size += GetLevelSize(i);
+    }
+    return size;
+}
+
+size_t TextureArray::GetLevelSize(int level) const
+{
+    return GetLayerLevelSize(level) * m_capacity;
+}
+
+// One level of a single layer
+size_t TextureArray::GetLayerLevelSize(int level) const
+{
+    int width = std::max(1, m_width >> level), height = std::max(1, m_height >> level);
+    if (m_format == KTX2_FORMAT_R8G8B8A8_UNORM) {
+        return size_t(width) * height * 4;
+    }
+    return CompressedSize(width, height, m_format);
+}
+
+std::vector<Image> TextureArray::PadLevels(const std::vector<Image> &levels, int width,
+        int height)
+{
+    std::vector<Image> padded;
+    if (levels.empty()) {
+        return padded;
+    }
+    int count = LevelCount(width, height);
+    for (int i = 0; i < count; ++i) {
+        const Image &src = levels[std::min(size_t(i), levels.size() - 1)];
+        Image dst;
+        dst.width = std::max(1, width >> i);
+        dst.height = std::max(1, height >> i);
+        dst.pixels.resize(size_t(dst.width) * dst.height * 4);
+        int copyWidth = std::min(src.width, dst.width);
+        for (int y = 0; y < dst.height; ++y) {
+            const unsigned char *srcRow =
+                    &src.pixels[size_t(std::min(y, src.height - 1)) * src.width * 4];
+            unsigned char *dstRow = &dst.pixels[size_t(y) * dst.width * 4];
+            std::memcpy(dstRow, srcRow, size_t(copyWidth) * 4);
+            for (int x = copyWidth; x < dst.width; ++x) {
+                std::memcpy(dstRow + x * 4, srcRow + (copyWidth - 1) * 4, 4);
+            }
+        }
+        padded.push_back(std::move(dst));
+    }
+    return padded;
+}
+
+std::vector<Image> TextureArray::PadBlocks(uint32_t format,
+        const std::vector<TextureLevel> &levels, int width, int height)
+{
+    std::vector<Image> padded;
+    if (levels.empty()) {
+        return padded;
+    }
+    size_t blockSize = CompressedSize(4, 4, format);
+    int count = LevelCount(width, height);
+    for (int i = 0; i < count; ++i) {
+        const TextureLevel &src = levels[std::min(size_t(i), levels.size() - 1)];
+        if (src.size < CompressedSize(src.width, src.height, format)) {
+            return {};
+        }
+        Image dst;
+        dst.width = std::max(1, width >> i);
+        dst.height = std::max(1, height >> i);
+        dst.pixels.resize(CompressedSize(dst.width, dst.height, format));
+        int srcBlocksX = (src.width + 3) / 4, srcBlocksY = (src.height + 3) / 4;
+        int dstBlocksX = (dst.width + 3) / 4, dstBlocksY = (dst.height + 3) / 4;
+        int copyBlocks = std::min(srcBlocksX, dstBlocksX);
+        for (int y = 0; y < dstBlocksY; ++y) {
+            const unsigned char *srcRow =
+                    src.data + size_t(std::min(y, srcBlocksY - 1)) * srcBlocksX * blockSize;
+            unsigned char *dstRow = &dst.pixels[size_t(y) * dstBlocksX * blockSize];
+            std::memcpy(dstRow, srcRow, copyBlocks * blockSize);
+            for (int x = copyBlocks; x < dstBlocksX; ++x) {
+                std::memcpy(dstRow + x * blockSize, srcRow + (copyBlocks - 1) * blockSize,
+                        blockSize);
+            }
+        }
+        padded.push_back(std::move(dst));
+    }
+    return padded;
+}
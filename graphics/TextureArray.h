@@ -0,0 +1,98 @@
+#ifndef GRAPHICS_TEXTUREARRAY_H
+#define GRAPHICS_TEXTUREARRAY_H
+
+#include <GL/glew.h>
+#include <memory>
+#include <vector>
+
+#include "Image.h"
+#include "PixelUploadRing.h"
+#include "TextureFile.h"
+
+/*
+ * GL_TEXTURE_2D_ARRAY with a full mip chain, in RGBA8 or a block-compressed
+ * KTX2 format the driver samples. Each layer holds one texture, so
+ * filtering and mip generation never mix neighbouring textures the way a
+ * shared atlas would. Sample it with clamp-to-edge
+ * wrapping: the shader repeats within the layer's used area.
+ * Only levels from the base level down are resident; the layers' source
+ * levels are kept so finer levels can be streamed in again. Storage
+ * starts with one layer and doubles as layers are added, up to maxLayers.
+ */
+class TextureArray
+{
+public:
+    TextureArray(int width, int height, int maxLayers, int baseLevel = 0,
+            uint32_t format = KTX2_FORMAT_R8G8B8A8_UNORM);
+    TextureArray(const TextureArray &other) = delete;
+    TextureArray(TextureArray &&other);
+    ~TextureArray();
+
+    /*
+     * levels must come from PadLevels, or PadBlocks for compressed arrays, with
+     * this array's size and format. staged, if not empty, are the same levels
+     * in ring memory. Returns the layer or -1 if full
+     */
+    int AddLayer(std::shared_ptr<const std::vector<Image>> levels,
+            PixelUploadRing *ring = nullptr, const std::vector<TextureLevel> &staged = {});
+    // Another user of the layer, see RemoveLayer
+    void RetainLayer(int layer);
+    // Once every user has removed it the layer can be reused; its texels stay until then
+    void RemoveLayer(int layer);
+    // Makes the next finer level resident. False if the base level is already 0
+    bool StreamIn(PixelUploadRing *ring = nullptr);
+    // Frees the finest resident level. False if only the smallest level is left
+    bool Evict();
+
+    void Bind() const;
+    int GetWidth() const;
+    int GetHeight() const;
+    int GetLevelCount() const;
+    uint32_t GetFormat() const;
+    int GetBaseLevel() const;
+    bool IsFull() const;
+    bool IsEmpty() const;
+    // Resident levels only
+    size_t GetMemorySize() const;
+    // One level of every allocated layer
+    size_t GetLevelSize(int level) const;
+
+    /*
+     * Places an image and its mips in the top-left corner of width x height
+     * layer levels, replicating the edge texels into the padding. Levels the
+     * image chain lacks repeat its smallest level.
+     */
+    static std::vector<Image> PadLevels(const std::vector<Image> &levels, int width, int height);
+    /*
+     * PadLevels for block-compressed levels: whole blocks go to the top-left
+     * corner and the edge blocks are repeated into the padding. Each Image
+     * holds a level's blocks instead of pixels. Empty if a level is too small.
+     */
+    static std::vector<Image> PadBlocks(uint32_t format, const std::vector<TextureLevel> &levels,
+            int width, int height);
+
+private:
+    void Allocate(int layers);
+    void DefineLevel(int level, int width, int height, int layers);
+    size_t GetLayerLevelSize(int level) const;
+    void Grow(PixelUploadRing *ring);
+    void UploadLevel(int level, int layer, PixelUploadRing *ring,
+            const unsigned char *staged = nullptr);
+
+private:
+    static const TextureArray *                 m_curBound;
+
+private:
+    GLuint                                      m_id = 0;
+    int                                         m_width;
+    int                                         m_height;
+    int                                         m_levels;
+    int                                         m_layers;      // at most
+    int                                         m_capacity = 0; // allocated
+    int                                         m_baseLevel;
+    uint32_t                                    m_format;
+    std::vector<std::shared_ptr<const std::vector<Image>>> m_sources;
+    std::vector<int>                            m_users;       // per layer
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "BlockCompress.h"
+#include "TextureFile.h"
+
+namespace {
+
+const unsigned char KTX2_IDENTIFIER[12] = {
+    0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+enum {
+    LEVEL_ALIGNMENT = 16,
+    MAX_DIMENSION = 1 << 16                     // keeps level sizes far from overflowing
+};
+
+struct Ktx2Header
+{
+    unsigned char                               identifier[12];
+    uint32_t                                    vkFormat;
+    uint32_t                                    typeSize;
+    uint32_t                                    pixelWidth;
+    uint32_t                                    pixelHeight;
+    uint32_t                                    pixelDepth;
+    uint32_t                                    layerCount;
+    uint32_t                                    faceCount;
+    uint32_t                                    levelCount;
+    uint32_t                                    supercompressionScheme;
+    uint32_t                                    dfdByteOffset;
+    uint32_t                                    dfdByteLength;
+    uint32_t                                    kvdByteOffset;
+    uint32_t                                    kvdByteLength;
+    uint64_t                                    sgdByteOffset;
+    uint64_t                                    sgdByteLength;
+};
+
+struct Ktx2Level
+{
+    uint64_t                                    byteOffset;
+    uint64_t                                    byteLength;
+    uint64_t                                    uncompressedByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+
+const Ktx2Header &Header(const MappedFile &file)
+{
+    return *reinterpret_cast<const Ktx2Header *>(file.Data());
+}
+
+const Ktx2Level &LevelIndex(const MappedFile &file, size_t level)
+{
+    return reinterpret_cast<const Ktx2Level *>(file.Data() + sizeof(Ktx2Header))[level];
+}
+
+// Bytes a level of the given size must hold, 0 for unknown formats
+size_t LevelSize(uint32_t format, int width, int height)
+{
+    if (format == KTX2_FORMAT_R8G8B8A8_UNORM) {
+        return size_t(width) * height * 4;
+    }
+    return IsBlockCompressed(format) ? CompressedSize(width, height, format) : 0;
+}
+
+}
+
+TextureFile::TextureFile(const std::string &path) :
+    m_file(path)
+{
+    if (m_file.IsOpen()) {
+        m_valid = Validate(path);
+    }
+}
+
+bool TextureFile::IsOpen() const
+{
+    return m_valid;
+}
+
+uint32_t TextureFile::GetFormat() const
+{
+    return Header(m_file).vkFormat;
+}
+
+size_t TextureFile::GetLevelCount() const
+{
+    return Header(m_file).levelCount;
+}
+
+TextureLevel TextureFile::GetLevel(size_t level) const
+{
+    const Ktx2Header &h = Header(m_file);
+    const Ktx2Level &l = LevelIndex(m_file, level);
+    return {
+        std::max(1, static_cast<int>(h.pixelWidth >> level)),
+        std::max(1, static_cast<int>(h.pixelHeight >> level)),
+        m_file.Data() + l.byteOffset,
+        static_cast<size_t>(l.byteLength)
+    };
+}
+
+bool TextureFile::Validate(const std::string &path) const
+{
+    if (m_file.Size() < sizeof(Ktx2Header) ||
+            std::memcmp(m_file.Data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+        std::cerr << "Not a KTX2 texture file: " << path << std::endl;
+        return false;
+    }
+    const Ktx2Header &h = Header(m_file);
+    if (h.pixelDepth > 1 || h.layerCount > 1 || h.faceCount != 1 ||
+            h.supercompressionScheme != 0 || h.levelCount == 0 || h.levelCount > 32 ||
+            LevelSize(h.vkFormat, 1, 1) == 0) {
+        std::cerr << "Unsupported KTX2 texture: " << path << std::endl;
+        return false;
+    }
+    if (h.pixelWidth == 0 || h.pixelHeight == 0 ||
+            h.pixelWidth > MAX_DIMENSION || h.pixelHeight > MAX_DIMENSION ||
+            sizeof(Ktx2Header) + h.levelCount * sizeof(Ktx2Level) > m_file.Size()) {
+        std::cerr << "Corrupted texture file: " << path << std::endl;
+        return false;
+    }
+    // Consumers read whole levels, so every level must be exactly as large as its size needs
+    for (size_t i = 0; i < h.levelCount; ++i) {
+        const Ktx2Level &l = LevelIndex(m_file, i);
+        int width = std::max(1u, h.pixelWidth >> i);
+        int height = std::max(1u, h.pixelHeight >> i);
+        if (l.byteOffset > m_file.Size() || l.byteLength > m_file.Size() - l.byteOffset ||
+                l.byteLength != LevelSize(h.vkFormat, width, height)) {
+            std::cerr << "Corrupted texture file: " << path << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TextureFile::Write(const std::string &path, uint32_t format,
+        const std::vector<TextureLevel> &levels)
+{
+    Ktx2Header h = {};
+    std::memcpy(h.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    h.vkFormat = format;
+    h.typeSize = 1;
+    h.pixelWidth = levels[0].width;
+    h.pixelHeight = levels[0].height;
+    h.faceCount = 1;
+    h.levelCount = levels.size();
+
+    // Smallest level goes first, as KTX2 requires
+    std::vector<Ktx2Level> index(levels.size());
+    uint64_t offset = sizeof(h) + index.size() * sizeof(Ktx2Level);
+    for (size_t i = levels.size(); i-- > 0;) {
+        offset = (offset + LEVEL_ALIGNMENT - 1) & ~uint64_t(LEVEL_ALIGNMENT - 1);
+        index[i] = {offset, levels[i].size, levels[i].size};
+        offset += levels[i].size;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Could not create texture file: " << path << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    file.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(Ktx2Level));
+    uint64_t written = sizeof(h) + index.size() * sizeof(Ktx2Level);
+    static const char padding[LEVEL_ALIGNMENT] = {};
+    for (size_t i = levels.size(); i-- > 0;) {
+        file.write(padding, index[i].byteOffset - written);
+        file.write(reinterpret_cast<const char *>(levels[i].data), levels[i].size);
+        written = index[i].byteOffset + levels[i].size;
+    }
+    if (!file) {
+        std::cerr << "Failed to write texture file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,54 @@
+#ifndef GRAPHICS_TEXTUREFILE_H
+#define GRAPHICS_TEXTUREFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+/*
+ * GPU-ready texture container using the KTX2 file layout: header, level
+ * index and mip levels stored smallest first. Only single-layer 2D
+ * textures without supercompression are supported, and no data format
+ * descriptor is written; vkFormat alone identifies the format.
+ */
+enum {
+    KTX2_FORMAT_R8G8B8A8_UNORM = 37,
+    KTX2_FORMAT_BC1_RGBA_UNORM = 133,
+    KTX2_FORMAT_BC3_UNORM = 137,
+    KTX2_FORMAT_BC7_UNORM = 145
+};
+
+struct TextureLevel
+{
+    int                                         width;
+    int                                         height;
+    const unsigned char *                       data;
+    size_t                                      size;
+};
+
+class TextureFile
+{
+public:
+    TextureFile(const std::string &path);
+
+    bool IsOpen() const;
+    uint32_t GetFormat() const;
+    size_t GetLevelCount() const;
+    TextureLevel GetLevel(size_t level) const;
+
+    // levels[0] is the full resolution image
+    static bool Write(const std::string &path, uint32_t format,
+            const std::vector<TextureLevel> &levels);
+
+private:
+    bool Validate(const std::string &path) const;
+
+private:
+    MappedFile                                  m_file;
+    bool                                        m_valid = false;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include <algorithm>
+
+#include "BlockCompress.h"
+#include "TextureManager.h"
+
+TextureManager::TextureManager(int layersPerArray, int residentSize) :
+    m_layersPerArray(layersPerArray),
+    m_residentSize(residentSize)
+{
+}
+
+TextureSlot *TextureManager::CreateSlot()
+{
+    for (size_t i = 0; i < m_freeSlots.size(); ++i) {
+        TextureSlot *slot = m_freeSlots[i];
+        if (slot->loads == 0) {
+            m_freeSlots[i] = m_freeSlots.back();
+            m_freeSlots.pop_back();
+            *slot = TextureSlot();
+            return slot;
+        }
+    }
+    m_slots.emplace_back();
+    return &m_slots.back();
+}
+
+void TextureManager::Insert(TextureSlot *slot, std::shared_ptr<const std::vector<Image>> levels,
+        int width, int height, PixelUploadRing *ring, const std::vector<TextureLevel> &staged,
+        uint32_t format)
+{
+    if (levels->empty() || slot->released) {
+        return;
+    }
+    TextureArray *previous = slot->array;
+    if (previous) {
+        previous->RemoveLayer(slot->layer);
+    }
+    int layerWidth = levels->front().width, layerHeight = levels->front().height;
+    TextureArray *array = nullptr;
+    for (auto &candidate : m_arrays) {
+        if (candidate->GetWidth() == layerWidth && candidate->GetHeight() == layerHeight &&
+                candidate->GetFormat() == format && !candidate->IsFull()) {
+            array = candidate.get();
+            break;
+        }
+    }
+    if (!array) {
+        int baseLevel = 0;
+        int size = std::max(layerWidth, layerHeight);
+        while (m_residentSize > 0 && (size >> baseLevel) > m_residentSize) {
+            ++baseLevel;
+        }
+        m_arrays.push_back(std::make_unique<TextureArray>(layerWidth, layerHeight,
+                    m_layersPerArray, baseLevel, format));
+        array = m_arrays.back().get();
+    }
+
+    int layer = array->AddLayer(std::move(levels), ring, staged);
+    if (layer < 0) {
+        slot->array = nullptr;
+        slot->layer = -1;
+    } else {
+        slot->layer = layer;
+        slot->uvTransform = glm::vec4(float(width) / array->GetWidth(),
+                float(height) / array->GetHeight(), 0.0, 0.0);
+        slot->array = array;
+    }
+    if (previous && previous != array && previous->IsEmpty()) {
+        RemoveArray(previous);
+    }
+    // A new array the layer did not fit into
+    if (array->IsEmpty()) {
+        RemoveArray(array);
+    }
+}
+
+void TextureManager::Share(TextureSlot *slot, const TextureSlot *source)
+{
+    if (slot->released || !source->IsReady() || slot == source) {
+        return;
+    }
+    source->array->RetainLayer(source->layer);
+    TextureArray *previous = slot->array;
+    if (previous) {
+        previous->RemoveLayer(slot->layer);
+    }
+    slot->array = source->array;
+    slot->layer = source->layer;
+    slot->uvTransform = source->uvTransform;
+    if (previous && previous->IsEmpty()) {
+        RemoveArray(previous);
+    }
+}
+
+void TextureManager::RemoveArray(TextureArray *array)
+{
+    if (m_arrayRemoved) {
+        m_arrayRemoved(array);
+    }
+    m_arrays.erase(std::find_if(m_arrays.begin(), m_arrays.end(),
+            [=](const auto &candidate) { return candidate.get() == array; }));
+}
+
+void TextureManager::Release(TextureSlot *slot)
+{
+    if (slot->released) {
+        return;
+    }
+    slot->released = true;
+    m_freeSlots.push_back(slot);
+    TextureArray *array = slot->array;
+    if (!array) {
+        return;
+    }
+    array->RemoveLayer(slot->layer);
+    slot->array = nullptr;
+    slot->layer = -1;
+    if (array->IsEmpty()) {
+        RemoveArray(array);
+    }
+}
+
+void TextureManager::SetArrayRemovedCallback(ArrayRemoved callback)
+{
+    m_arrayRemoved = std::move(callback);
+}
+
+const std::vector<std::unique_ptr<TextureArray>> &TextureManager::GetArrays() const
+{
+    return m_arrays;
+}
+
+size_t TextureManager::GetArrayCount() const
+{
+    return m_arrays.size();
+}
+
+size_t TextureManager::GetMemorySize() const
+{
+    size_t size = 0;
+    for (const auto &array : m_arrays) {
+        size += array->GetMemorySize();
+    }
+    return size;
+}
+
+int TextureManager::LayerSize(int size, uint32_t format)
+{
+    int layerSize = IsBlockCompressed(format) ? 4 : 1;
+    while (layerSize < size) {
+        layerSize *= 2;
+    }
+    return layerSize;
+}
@@ -0,0 +1,81 @@
+#ifndef GRAPHICS_TEXTUREMANAGER_H
+#define GRAPHICS_TEXTUREMANAGER_H
+
+#include <deque>
+#include <functional>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "Image.h"
+#include "PixelUploadRing.h"
+#include "TextureArray.h"
+
+// Where a texture lives inside the manager's arrays
+struct TextureSlot
+{
+    bool IsReady() const { return array != nullptr; }
+
+    TextureArray *                              array = nullptr;
+    int                                         layer = -1;
+    glm::vec4                                   uvTransform = {1.0, 1.0, 0.0, 0.0}; // scale, offset
+    bool                                        released = false; // a pending load is dropped
+    unsigned                                    loads = 0;  // pending loads, block reuse
+};
+
+/*
+ * Packs textures into texture arrays, one per format and power-of-two
+ * layer size. Images smaller than their layer are padded and get a UV
+ * transform, so entities sharing an array differ only by uniforms and need
+ * no texture rebinding between draws. Slot addresses stay valid for the
+ * manager's lifetime; released slots are reused. With residentSize > 0
+ * new arrays start with only the levels no larger than that resident, for
+ * TextureStreamer to refine.
+ */
+class TextureManager
+{
+public:
+    using ArrayRemoved = std::function<void(const TextureArray *)>;
+
+    TextureManager(int layersPerArray = 16, int residentSize = 0);
+    TextureManager(const TextureManager &other) = delete;
+
+    // Empty slot for a texture that is about to be loaded
+    TextureSlot *CreateSlot();
+    /*
+     * GL thread only. levels come from TextureArray::PadLevels, or PadBlocks
+     * for a block-compressed format, with LayerSize; staged optionally holds
+     * copies of them already written into the ring. A slot that already holds
+     * a texture moves to the new one.
+     */
+    void Insert(TextureSlot *slot, std::shared_ptr<const std::vector<Image>> levels, int width,
+            int height, PixelUploadRing *ring = nullptr,
+            const std::vector<TextureLevel> &staged = {},
+            uint32_t format = KTX2_FORMAT_R8G8B8A8_UNORM);
+    // GL thread only. The slot uses source's layer too, until either moves or is released
+    void Share(TextureSlot *slot, const TextureSlot *source);
+    // GL thread only. Frees the slot's layer and the array once it is empty
+    void Release(TextureSlot *slot);
+    // Called before an array is destroyed, e.g. to drop pointers to it
+    void SetArrayRemovedCallback(ArrayRemoved callback);
+
+    const std::vector<std::unique_ptr<TextureArray>> &GetArrays() const;
+    size_t GetArrayCount() const;
+    size_t GetMemorySize() const;
+
+    // Layer size for an image dimension, whole 4x4 blocks for block-compressed formats
+    static int LayerSize(int size, uint32_t format = KTX2_FORMAT_R8G8B8A8_UNORM);
+
+private:
+    void RemoveArray(TextureArray *array);
+
+private:
+    int                                         m_layersPerArray;
+    int                                         m_residentSize;
+    std::deque<TextureSlot>                     m_slots;
+    std::vector<TextureSlot *>                  m_freeSlots;
+    ArrayRemoved                                m_arrayRemoved;
+    std::vector<std::unique_ptr<TextureArray>>  m_arrays;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include <filesystem>
+#include <iostream>
+#include <unordered_set>
+
+#include "TextureRegistry.h"
+
+TextureRegistry::TextureRegistry(TextureManager *manager, AssetLoader *loader) :
+    m_manager(manager),
+    m_loader(loader),
+    m_known(std::make_shared<KnownContent>())
+{
+}
+
+TextureRegistry::Handle TextureRegistry::Acquire(const std::string &path)
+{
+    std::string canonical = Canonical(path);
+
+    auto byPath = m_byPath.find(canonical);
+    if (byPath != m_byPath.end()) {
+        if (Handle handle = byPath->second.slot.lock()) {
+            ++m_stats.pathHits;
+            return handle;
+        }
+    }
+
+    TextureSlot *slot = m_manager->CreateSlot();
+    Handle handle(slot, [this, canonical](const TextureSlot *released) {
+        m_manager->Release(const_cast<TextureSlot *>(released));
+        Forget(canonical);
+        ++m_stats.releases;
+    });
+    // Content hash 0 until the loader has read the file
+    m_byPath[canonical] = {handle, 0};
+    Load(slot, path, canonical);
+    ++m_stats.loads;
+    return handle;
+}
+
+bool TextureRegistry::Reload(const std::string &path)
+{
+    std::string canonical = Canonical(path);
+    auto entry = m_byPath.find(canonical);
+    if (entry == m_byPath.end()) {
+        return false;
+    }
+    Handle handle = entry->second.slot.lock();
+    if (!handle) {
+        return false;
+    }
+
+    Load(const_cast<TextureSlot *>(handle.get()), path, canonical);
+    ++m_stats.reloads;
+    return true;
+}
+
+void TextureRegistry::Load(TextureSlot *slot, const std::string &path,
+        const std::string &canonical)
+{
+    // The loader's workers may outlive the registry, they hold the set instead
+    std::shared_ptr<KnownContent> known = m_known;
+    m_loader->LoadTexture(slot, path, m_manager, [=](uint64_t hash) {
+        return OnContent(slot, canonical, hash);
+    }, [known](uint64_t hash) {
+        std::lock_guard<std::mutex> lock(known->mutex);
+        return known->hashes.count(hash) != 0;
+    });
+}
+
+bool TextureRegistry::OnContent(TextureSlot *slot, const std::string &canonical, uint64_t hash)
+{
+    // The handle may be gone while its load was in flight
+    auto entry = m_byPath.find(canonical);
+    if (slot->released || entry == m_byPath.end()) {
+        return true;
+    }
+    Handle handle = entry->second.slot.lock();
+    if (handle.get() != slot) {
+        return true;
+    }
+
+    uint64_t previous = entry->second.contentHash;
+    entry->second.contentHash = hash;
+    auto byContent = m_byContent.find(previous);
+    if (previous != hash && byContent != m_byContent.end() && byContent->second.lock() == handle) {
+        m_byContent.erase(byContent);
+        Publish(previous, false);
+    }
+    // Content hash 0: unreadable, the loader reports it
+    if (hash == 0) {
+        return false;
+    }
+
+    byContent = m_byContent.find(hash);
+    if (byContent != m_byContent.end()) {
+        Handle other = byContent->second.lock();
+        if (other && other != handle && other->IsReady()) {
+            m_manager->Share(slot, other.get());
+            ++m_stats.contentHits;
+            return true;
+        }
+    }
+    m_byContent[hash] = handle;
+    Publish(hash, true);
+    return false;
+}
+
+// Called from a handle's deleter, when the weak pointers to it have expired
+void TextureRegistry::Forget(const std::string &canonical)
+{
+    auto entry = m_byPath.find(canonical);
+    if (entry == m_byPath.end() || !entry->second.slot.expired()) {
+        return;
+    }
+    uint64_t hash = entry->second.contentHash;
+    m_byPath.erase(entry);
+
+    auto byContent = m_byContent.find(hash);
+    if (byContent == m_byContent.end() || !byContent->second.expired()) {
+        return;
+    }
+    // Another live texture with the same contents takes over
+    for (const auto &other : m_byPath) {
+        if (other.second.contentHash == hash && !other.second.slot.expired()) {
+            byContent->second = other.second.slot;
+            return;
+        }
+    }
+    m_byContent.erase(byContent);
+    Publish(hash, false);
+}
+
+void TextureRegistry::Publish(uint64_t hash, bool known)
+{
+    std::lock_guard<std::mutex> lock(m_known->mutex);
+    if (known) {
+        m_known->hashes.insert(hash);
+    } else {
+        m_known->hashes.erase(hash);
+    }
+}
+
+size_t TextureRegistry::GetLiveCount() const
+{
+    std::unordered_set<const TextureSlot *> live;
+    for (const auto &entry : m_byPath) {
+        if (Handle handle = entry.second.slot.lock()) {
+            live.insert(handle.get());
+        }
+    }
+    return live.size();
+}
+
+const TextureRegistry::Stats &TextureRegistry::GetStats() const
+{
+    return m_stats;
+}
+
+void TextureRegistry::PrintStats() const
+{
+    std::cout << "Texture registry: " << m_stats.loads << " loads, " <<
+            m_stats.pathHits + m_stats.contentHits << " duplicate loads avoided (" <<
+            m_stats.pathHits << " by path, " << m_stats.contentHits << " by content), " <<
+            m_stats.releases << " released, " << m_stats.reloads << " reloaded, " <<
+            GetLiveCount() << " live" << std::endl;
+}
+
+std::string TextureRegistry::Canonical(const std::string &path)
+{
+    std::error_code error;
+    std::string canonical = std::filesystem::weakly_canonical(path, error).string();
+    if (error) {
+        canonical = std::filesystem::path(path).lexically_normal().string();
+    }
+    return canonical;
+}
@@ -0,0 +1,85 @@
+#ifndef GRAPHICS_TEXTUREREGISTRY_H
+#define GRAPHICS_TEXTUREREGISTRY_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "AssetLoader.h"
+#include "TextureManager.h"
+
+/*
+ * Shared texture handles. Requests for the same canonical path return the
+ * existing handle instead of loading again. A different file with the
+ * same contents gets its own handle, but the loader hashes the file
+ * before decoding it and the handle then shares the existing texture's
+ * layer instead of decoding and uploading a copy. The texture's layer is released when the
+ * last handle goes away, so handles must be dropped on the GL thread and
+ * before the registry.
+ */
+class TextureRegistry
+{
+public:
+    using Handle = std::shared_ptr<const TextureSlot>;
+
+    struct Stats
+    {
+        uint64_t                                loads = 0;
+        uint64_t                                pathHits = 0;
+        uint64_t                                contentHits = 0;
+        uint64_t                                releases = 0;
+        uint64_t                                reloads = 0;
+    };
+
+    TextureRegistry(TextureManager *manager, AssetLoader *loader);
+    TextureRegistry(const TextureRegistry &other) = delete;
+
+    Handle Acquire(const std::string &path);
+    /*
+     * Loads a changed file again into the slot its handles point to. The
+     * old texture stays until the new one is uploaded, or for good if the
+     * load fails. False if nothing holds the path.
+     */
+    bool Reload(const std::string &path);
+
+    // Textures with at least one handle
+    size_t GetLiveCount() const;
+    const Stats &GetStats() const;
+    void PrintStats() const;
+
+private:
+    static std::string Canonical(const std::string &path);
+    void Load(TextureSlot *slot, const std::string &path, const std::string &canonical);
+    // GL thread, when the load of canonical has read its file. True if the slot shares a texture
+    bool OnContent(TextureSlot *slot, const std::string &canonical, uint64_t hash);
+    // Drops the entries of a released texture
+    void Forget(const std::string &canonical);
+    // Mirrors m_byContent's keys for the loader's workers
+    void Publish(uint64_t hash, bool known);
+
+private:
+    struct Entry
+    {
+        std::weak_ptr<const TextureSlot>        slot;
+        uint64_t                                contentHash;
+    };
+
+    struct KnownContent
+    {
+        std::mutex                              mutex;
+        std::unordered_set<uint64_t>            hashes;
+    };
+
+private:
+    TextureManager *                            m_manager;
+    AssetLoader *                               m_loader;
+    std::unordered_map<std::string, Entry>      m_byPath;
+    std::unordered_map<uint64_t, std::weak_ptr<const TextureSlot>> m_byContent;
+    std::shared_ptr<KnownContent>               m_known;
+    Stats                                       m_stats;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "TextureStreamer.h"
+
+TextureStreamer::TextureStreamer(TextureManager *manager, size_t budget, int levelsPerFrame) :
+    m_manager(manager),
+    m_budget(budget),
+    m_levelsPerFrame(levelsPerFrame)
+{
+    // Requests point at arrays that releases in the same frame may free
+    m_manager->SetArrayRemovedCallback([this](const TextureArray *array) {
+        m_wanted.erase(array);
+    });
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    m_manager->SetArrayRemovedCallback(nullptr);
+}
+
+void TextureStreamer::BeginFrame(const glm::vec3 &viewPos, float pixelsPerUnit)
+{
+    m_viewPos = viewPos;
+    m_pixelsPerUnit = pixelsPerUnit;
+    m_wanted.clear();
+}
+
+// Assumes the texture is mapped once across the object
+void TextureStreamer::Request(const TextureSlot *slot, const glm::vec3 &position, float radius)
+{
+    if (!slot || !slot->IsReady()) {
+        return;
+    }
+    const TextureArray *array = slot->array;
+    float distance = std::max(glm::length(position - m_viewPos), radius);
+    float screenSize = 2.0f * radius * m_pixelsPerUnit / distance;
+    float texels = std::max(array->GetWidth() * slot->uvTransform.x,
+            array->GetHeight() * slot->uvTransform.y);
+    int level = screenSize >= texels ? 0 : static_cast<int>(std::log2(texels / screenSize));
+    level = std::min(level, array->GetLevelCount() - 1);
+
+    auto it = m_wanted.find(array);
+    if (it == m_wanted.end()) {
+        m_wanted.emplace(array, level);
+    } else {
+        it->second = std::min(it->second, level);
+    }
+}
+
+void TextureStreamer::Update(PixelUploadRing *ring)
+{
+    const auto &arrays = m_manager->GetArrays();
+    size_t resident = m_manager->GetMemorySize();
+
+    while (resident > m_budget) {
+        TextureArray *array = FindEvictable(nullptr);
+        if (!array) {
+            break;
+        }
+        resident -= array->GetLevelSize(array->GetBaseLevel());
+        array->Evict();
+        ++m_stats.evicted;
+    }
+
+    for (int i = 0; i < m_levelsPerFrame; ++i) {
+        TextureArray *best = nullptr;
+        int bestDeficit = 0;
+        for (const auto &array : arrays) {
+            int deficit = array->GetBaseLevel() - GetWantedLevel(array.get());
+            if (deficit > bestDeficit) {
+                best = array.get();
+                bestDeficit = deficit;
+            }
+        }
+        if (!best) {
+            break;
+        }
+
+        size_t cost = best->GetLevelSize(best->GetBaseLevel() - 1);
+        while (resident + cost > m_budget) {
+            TextureArray *victim = FindEvictable(best);
+            if (!victim) {
+                break;
+            }
+            resident -= victim->GetLevelSize(victim->GetBaseLevel());
+            victim->Evict();
+            ++m_stats.evicted;
+        }
+        if (resident + cost > m_budget) {
+            break;
+        }
+        best->StreamIn(ring);
+        resident += cost;
+        ++m_stats.streamedIn;
+    }
+
+    m_stats.budget = m_budget;
+    m_stats.resident = resident;
+    m_stats.arrays = arrays.size();
+    m_stats.arraysResident = 0;
+    m_stats.wanted = 0;
+    for (const auto &array : arrays) {
+        int wanted = GetWantedLevel(array.get());
+        for (int level = wanted; level < array->GetLevelCount(); ++level) {
+            m_stats.wanted += array->GetLevelSize(level);
+        }
+        if (array->GetBaseLevel() <= wanted) {
+            ++m_stats.arraysResident;
+        }
+    }
+    if (resident > m_budget || m_stats.wanted > m_budget) {
+        ++m_stats.overBudgetFrames;
+    }
+}
+
+void TextureStreamer::SetBudget(size_t budget)
+{
+    m_budget = budget;
+}
+
+const TextureStreamer::Stats &TextureStreamer::GetStats() const
+{
+    return m_stats;
+}
+
+void TextureStreamer::PrintStats() const
+{
+    std::cout << "Texture streaming: " << m_stats.resident / 1024 << " KiB resident of " <<
+            m_stats.budget / 1024 << " KiB budget, " << m_stats.wanted / 1024 << " KiB wanted, " <<
+            m_stats.arraysResident << "/" << m_stats.arrays << " arrays at their wanted level, " <<
+            m_stats.streamedIn << " levels streamed in, " << m_stats.evicted << " evicted, " <<
+            m_stats.overBudgetFrames << " frames over budget" << std::endl;
+}
+
+int TextureStreamer::GetWantedLevel(const TextureArray *array) const
+{
+    auto it = m_wanted.find(array);
+    return it == m_wanted.end() ? array->GetLevelCount() - 1 : it->second;
+}
+
+TextureArray *TextureStreamer::FindEvictable(const TextureArray *except) const
+{
+    TextureArray *best = nullptr;
+    int bestSurplus = 0;
+    for (const auto &array : m_manager->GetArrays()) {
+        int surplus = GetWantedLevel(array.get()) - array->GetBaseLevel();
+        if (array.get() != except && surplus > bestSurplus) {
+            best = array.get();
+            bestSurplus = surplus;
+        }
+    }
+    return best;
+}
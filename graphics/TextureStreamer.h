@@ -0,0 +1,64 @@
+#ifndef GRAPHICS_TEXTURESTREAMER_H
+#define GRAPHICS_TEXTURESTREAMER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <unordered_map>
+
+#include "PixelUploadRing.h"
+#include "TextureManager.h"
+
+/*
+ * Keeps the mip levels of the manager's texture arrays resident as far as
+ * the visible objects need them and the VRAM budget allows. The render
+ * pass reports each textured object; Update() then streams finer levels
+ * in, largest deficit first, and evicts levels nobody needs when over
+ * budget. Arrays not requested in a frame may drop to their smallest level.
+ */
+class TextureStreamer
+{
+public:
+    struct Stats
+    {
+        size_t                                  budget = 0;
+        size_t                                  resident = 0;
+        size_t                                  wanted = 0;       // if every array had its wanted level
+        size_t                                  arrays = 0;
+        size_t                                  arraysResident = 0; // at or above their wanted level
+        uint64_t                                streamedIn = 0;
+        uint64_t                                evicted = 0;
+        uint64_t                                overBudgetFrames = 0;
+    };
+
+    TextureStreamer(TextureManager *manager, size_t budget, int levelsPerFrame = 4);
+    TextureStreamer(const TextureStreamer &other) = delete;
+    ~TextureStreamer();
+
+    // pixelsPerUnit: screen pixels covered by one world unit at distance 1
+    void BeginFrame(const glm::vec3 &viewPos, float pixelsPerUnit);
+    // An object using the slot's texture, bounded by a sphere
+    void Request(const TextureSlot *slot, const glm::vec3 &position, float radius);
+    // GL thread, once per frame after rendering
+    void Update(PixelUploadRing *ring = nullptr);
+
+    void SetBudget(size_t budget);
+    const Stats &GetStats() const;
+    void PrintStats() const;
+
+private:
+    int GetWantedLevel(const TextureArray *array) const;
+    // The array holding the most unneeded levels, nullptr if none
+    TextureArray *FindEvictable(const TextureArray *except) const;
+
+private:
+    TextureManager *                            m_manager;
+    size_t                                      m_budget;
+    int                                         m_levelsPerFrame;
+    glm::vec3                                   m_viewPos;
+    float                                       m_pixelsPerUnit = 1.0;
+    std::unordered_map<const TextureArray *, int> m_wanted;
+    Stats                                       m_stats;
+};
+
+#endif
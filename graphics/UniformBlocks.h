@@ -0,0 +1,54 @@
+#ifndef GRAPHICS_UNIFORMBLOCKS_H
+#define GRAPHICS_UNIFORMBLOCKS_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+/*
+ * Uniform blocks shared by all programs. Each has a fixed binding point,
+ * assigned by Shader to every program that declares the block, and a C++
+ * struct matching its std140 layout in the shaders.
+ */
+enum UniformBlockBinding {
+    BLOCK_FRAME = 0,
+    BLOCK_LIGHT,
+    BLOCK_MATERIAL,
+    BLOCK_LAST
+};
+
+// Camera and shadow data, once per frame
+struct FrameBlock
+{
+    glm::mat4                                   lightSpaceTransform;
+    glm::vec3                                   viewPos;
+    float                                       pad0;
+};
+static_assert(offsetof(FrameBlock, lightSpaceTransform) == 0, "std140 layout");
+static_assert(offsetof(FrameBlock, viewPos) == 64, "std140 layout");
+static_assert(sizeof(FrameBlock) == 80, "std140 layout");
+
+struct LightBlock
+{
+    glm::vec3                                   position;
+    float                                       pad0;
+    glm::vec3                                   color;
+    float                                       pad1;
+};
+static_assert(offsetof(LightBlock, position) == 0, "std140 layout");
+static_assert(offsetof(LightBlock, color) == 16, "std140 layout");
+static_assert(sizeof(LightBlock) == 32, "std140 layout");
+
+// Per entity. textureLayer < 0: untextured, basicColor is used
+struct MaterialBlock
+{
+    glm::vec4                                   uvTransform;
+    glm::vec3                                   basicColor;
+    GLint                                       textureLayer;
+};
+static_assert(offsetof(MaterialBlock, uvTransform) == 0, "std140 layout");
+static_assert(offsetof(MaterialBlock, basicColor) == 16, "std140 layout");
+static_assert(offsetof(MaterialBlock, textureLayer) == 28, "std140 layout");
+static_assert(sizeof(MaterialBlock) == 32, "std140 layout");
+
+#endif
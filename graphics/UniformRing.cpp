@@ -0,0 +1,124 @@
+#include <cstring>
+#include <iostream>
+
+#include "GpuTracker.h"
+#include "UniformRing.h"
+
+UniformRing::UniformRing(size_t frameSize) :
+    m_frameSize(frameSize)
+{
+    GLint alignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment > 0) {
+        m_alignment = alignment;
+    }
+    m_frameSize = (m_frameSize + m_alignment - 1) / m_alignment * m_alignment;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, REGIONS * m_frameSize, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    GPU_TRACK(GPU_OBJECT_BUFFER, m_buffer, GPU_STAGING, REGIONS * m_frameSize, "uniform ring");
+}
+
+UniformRing::~UniformRing()
+{
+    for (GLsync fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    GpuTracker::Untrack(GPU_OBJECT_BUFFER, m_buffer);
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void UniformRing::BeginFrame()
+{
+    m_region = (m_region + 1) % REGIONS;
+    GLsync &fence = m_fences[m_region];
+    if (fence) {
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            ++m_stats.stalls;
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    m_staging.clear();
+    ++m_stats.frames;
+}
+
+size_t UniformRing::Push(const void *data, size_t size)
+{
+    size_t offset = (m_staging.size() + m_alignment - 1) / m_alignment * m_alignment;
+    m_staging.resize(offset + size);
+    std::memcpy(m_staging.data() + offset, data, size);
+    ++m_stats.blocks;
+    return offset;
+}
+
+void UniformRing::Upload()
+{
+    if (m_staging.empty()) {
+        return;
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    if (m_staging.size() > m_frameSize) {
+        // Orphaning keeps the storage pending draws read alive
+        while (m_frameSize < m_staging.size()) {
+            m_frameSize *= 2;
+        }
+        glBufferData(GL_UNIFORM_BUFFER, REGIONS * m_frameSize, nullptr, GL_STREAM_DRAW);
+        GpuTracker::Resize(GPU_OBJECT_BUFFER, m_buffer, REGIONS * m_frameSize);
+        for (GLsync &fence : m_fences) {
+            if (fence) {
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+        m_bound.clear();
+        ++m_stats.grows;
+    }
+    void *data = glMapBufferRange(GL_UNIFORM_BUFFER, m_region * m_frameSize, m_staging.size(),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (data) {
+        std::memcpy(data, m_staging.data(), m_staging.size());
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    } else {
+        std::cerr << "Failed to map the uniform ring" << std::endl;
+        glBufferSubData(GL_UNIFORM_BUFFER, m_region * m_frameSize, m_staging.size(),
+                m_staging.data());
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    m_stats.bytes += m_staging.size();
+}
+
+void UniformRing::Bind(GLuint binding, size_t offset, size_t size)
+{
+    offset += m_region * m_frameSize;
+    if (binding >= m_bound.size()) {
+        m_bound.resize(binding + 1, SIZE_MAX);
+    }
+    if (m_bound[binding] != offset) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_buffer, offset, size);
+        m_bound[binding] = offset;
+        ++m_stats.binds;
+    }
+}
+
+void UniformRing::EndFrame()
+{
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+const UniformRing::Stats &UniformRing::GetStats() const
+{
+    return m_stats;
+}
+
+void UniformRing::PrintStats() const
+{
+    std::cout << "Uniform ring: " << m_stats.frames << " frames, " << m_stats.blocks <<
+            " blocks, " << m_stats.bytes / double(1 << 20) << " MiB, " << m_stats.binds <<
+            " binds, " << m_stats.stalls << " stalls, " << m_stats.grows << " grows" << std::endl;
+}
@@ -0,0 +1,66 @@
+#ifndef GRAPHICS_UNIFORMRING_H
+#define GRAPHICS_UNIFORMRING_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Uniform buffer split into one region per frame in flight. Blocks pushed
+ * during a frame are gathered on the CPU and written with a single
+ * unsynchronized map; a fence per region keeps the CPU from overwriting
+ * data the GPU still reads. A region grows when a frame outgrows it.
+ * GL thread only.
+ */
+class UniformRing
+{
+public:
+    struct Stats
+    {
+        uint64_t                                frames = 0;
+        uint64_t                                blocks = 0;
+        uint64_t                                bytes = 0;
+        uint64_t                                stalls = 0; // waits for the GPU to free a region
+        uint64_t                                grows = 0;
+        uint64_t                                binds = 0;
+    };
+
+    UniformRing(size_t frameSize);
+    UniformRing(const UniformRing &other) = delete;
+    ~UniformRing();
+
+    // Starts a frame in the next region, waiting if the GPU still reads it
+    void BeginFrame();
+    // Copies a block into the frame; the returned offset is for Bind
+    size_t Push(const void *data, size_t size);
+    template <typename T>
+    size_t Push(const T &block)
+    {
+        return Push(&block, sizeof(T));
+    }
+    // Writes every block pushed this frame into the buffer, before any Bind
+    void Upload();
+    void Bind(GLuint binding, size_t offset, size_t size);
+    // Fences the region once the frame's draws are issued
+    void EndFrame();
+
+    const Stats &GetStats() const;
+    void PrintStats() const;
+
+private:
+    static constexpr int REGIONS = 3;
+
+private:
+    GLuint                                      m_buffer = 0;
+    size_t                                      m_frameSize;
+    size_t                                      m_alignment = 256;
+    int                                         m_region = 0;
+    GLsync                                      m_fences[REGIONS] = {};
+    std::vector<unsigned char>                  m_staging;
+    // Offset bound to each binding point, to skip repeated binds
+    std::vector<size_t>                         m_bound;
+    Stats                                       m_stats;
+};
+
+#endif
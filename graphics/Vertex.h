@@ -1,6 +1,7 @@
 #ifndef GRAPHICS_VERTEX_H
 #define GRAPHICS_VERTEX_H
 
+#include <cstdint>
 #include <glm/glm.hpp>
 
 struct Vertex
@@ -16,4 +17,14 @@ struct VertexN
     glm::vec3 normal;
 };
 
+// Compact VertexN, see VertexPack.h
+struct VertexP
+{
+    uint16_t pos[4];        // unorm16 within the mesh bounds, w is padding
+    uint32_t texCoords;     // 2x half float
+    uint32_t normal;        // 2x snorm16, octahedral encoding
+};
+
+static_assert(sizeof(VertexP) == 16, "VertexP must stay tightly packed");
+
 #endif
@@ -0,0 +1,143 @@
+#ifndef GRAPHICS_VERTEXLAYOUT_H
+#define GRAPHICS_VERTEXLAYOUT_H
+
+#include <GL/glew.h>
+#include <cstddef>
+
+#include "Vertex.h"
+
+/*
+ * Compile-time vertex layout descriptions. A layout is a type list of
+ * Attribute<> entries; VertexLayout<V> maps a vertex struct to its layout
+ * and Mesh generates the VAO setup from it.
+ */
+
+// Semantic attribute locations shared with the shaders
+enum {
+    ATTRIB_POSITION = 0,
+    ATTRIB_TEXCOORDS = 1,
+    ATTRIB_NORMAL = 2,
+    ATTRIB_LAST = 16
+};
+
+struct VertexAttribute
+{
+    GLuint                                      location;
+    GLint                                       size;
+    GLenum                                      type;
+    GLboolean                                   normalized;
+    bool                                        integer;    // glVertexAttribIPointer
+    size_t                                      offset;
+    size_t                                      bytes;
+};
+
+// Runtime view of a layout
+struct VertexLayoutDesc
+{
+    GLsizei                                     stride;
+    const VertexAttribute *                     attributes;
+    size_t                                      count;
+    unsigned                                    locationMask;
+};
+
+constexpr size_t GLTypeSize(GLenum type)
+{
+    switch (type) {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return 1;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:
+            return 2;
+        case GL_INT:
+        case GL_UNSIGNED_INT:
+        case GL_FLOAT:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+constexpr unsigned BitCount(unsigned mask)
+{
+    return mask ? (mask & 1) + BitCount(mask >> 1) : 0;
+}
+
+template <GLuint Location, GLint Size, GLenum Type, GLboolean Normalized, size_t Offset,
+        bool Integer = false>
+struct Attribute
+{
+    static_assert(Location < ATTRIB_LAST, "Attribute location out of range");
+    static_assert(Size >= 1 && Size <= 4, "Attribute must have 1 to 4 components");
+    static_assert(GLTypeSize(Type) != 0, "Unsupported attribute type");
+    static_assert(!(Integer && (Normalized || Type == GL_FLOAT || Type == GL_HALF_FLOAT)),
+            "Integer attributes can't be normalized or floating point");
+    static_assert(Offset % GLTypeSize(Type) == 0, "Misaligned attribute");
+
+    static constexpr VertexAttribute desc = {
+        Location, Size, Type, Normalized, Integer, Offset, Size * GLTypeSize(Type)
+    };
+};
+
+template <class V, class... Attrs>
+struct Layout
+{
+    using VertexType = V;
+
+    static_assert(((Attrs::desc.offset + Attrs::desc.bytes <= sizeof(V)) && ...),
+            "Attribute lies outside of the vertex");
+    static constexpr unsigned locationMask = ((1u << Attrs::desc.location) | ...);
+    static_assert(BitCount(locationMask) == sizeof...(Attrs), "Duplicate attribute location");
+
+    static constexpr VertexAttribute attributes[] = {Attrs::desc...};
+
+    static constexpr VertexLayoutDesc Describe()
+    {
+        return {sizeof(V), attributes, sizeof...(Attrs), locationMask};
+    }
+};
+
+template <class V>
+struct VertexLayout;
+
+template <>
+struct VertexLayout<Vertex> : Layout<Vertex,
+        Attribute<ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, pos)>,
+        Attribute<ATTRIB_TEXCOORDS, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texCoords)>>
+{
+};
+
+template <>
+struct VertexLayout<VertexN> : Layout<VertexN,
+        Attribute<ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE, offsetof(VertexN, pos)>,
+        Attribute<ATTRIB_TEXCOORDS, 2, GL_FLOAT, GL_FALSE, offsetof(VertexN, texCoords)>,
+        Attribute<ATTRIB_NORMAL, 3, GL_FLOAT, GL_FALSE, offsetof(VertexN, normal)>>
+{
+};
+
+template <>
+struct VertexLayout<VertexP> : Layout<VertexP,
+        Attribute<ATTRIB_POSITION, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(VertexP, pos)>,
+        Attribute<ATTRIB_TEXCOORDS, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(VertexP, texCoords)>,
+        Attribute<ATTRIB_NORMAL, 2, GL_SHORT, GL_TRUE, offsetof(VertexP, normal)>>
+{
+};
+
+// Enables and points all attributes of the layout at the bound GL_ARRAY_BUFFER
+inline void SetupVertexLayout(const VertexLayoutDesc &layout)
+{
+    for (size_t i = 0; i < layout.count; ++i) {
+        const VertexAttribute &a = layout.attributes[i];
+        glEnableVertexAttribArray(a.location);
+        if (a.integer) {
+            glVertexAttribIPointer(a.location, a.size, a.type, layout.stride,
+                    reinterpret_cast<void *>(a.offset));
+        } else {
+            glVertexAttribPointer(a.location, a.size, a.type, a.normalized, layout.stride,
+                    reinterpret_cast<void *>(a.offset));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cmath>
+
+#include "VertexPack.h"
+
+namespace {
+
+uint16_t QuantizeUnorm16(float val)
+{
+    return static_cast<uint16_t>(std::lround(std::clamp(val, 0.0f, 1.0f) * 65535.0f));
+}
+
+}
+
+// Maps a unit vector onto the [-1, 1] square
+glm::vec2 OctEncode(const glm::vec3 &normal)
+{
+    float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (l1 == 0.0f) {
+        return glm::vec2(0.0f, 0.0f);
+    }
+    glm::vec2 e(normal.x / l1, normal.y / l1);
+    if (normal.z < 0.0f) {
+        glm::vec2 folded((1.0f - std::abs(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f),
+                (1.0f - std::abs(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f));
+        e = folded;
+    }
+    return e;
+}
+
+PackedVertices PackVertices(const VertexN *vertices, size_t count)
+{
+    PackedVertices result;
+    glm::vec3 lo(0.0f, 0.0f, 0.0f), hi(0.0f, 0.0f, 0.0f);
+    if (count) {
+        lo = hi = vertices[0].pos;
+    }
+    for (size_t i = 1; i < count; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = std::min(lo[k], vertices[i].pos[k]);
+            hi[k] = std::max(hi[k], vertices[i].pos[k]);
+        }
+    }
+    result.posOffset = lo;
+    result.posScale = hi - lo;
+
+    result.vertices.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const VertexN &v = vertices[i];
+        VertexP &p = result.vertices[i];
+        for (int k = 0; k < 3; ++k) {
+            float extent = result.posScale[k];
+            p.pos[k] = extent > 0.0f ? QuantizeUnorm16((v.pos[k] - lo[k]) / extent) : 0;
+        }
+        p.pos[3] = 0;
+        p.texCoords = glm::packHalf2x16(v.texCoords);
+        p.normal = glm::packSnorm2x16(OctEncode(v.normal));
+    }
+    return result;
+}
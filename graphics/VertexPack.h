@@ -0,0 +1,24 @@
+#ifndef GRAPHICS_VERTEXPACK_H
+#define GRAPHICS_VERTEXPACK_H
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Vertex.h"
+
+/*
+ * Positions are stored relative to the mesh bounds and restored in the
+ * vertex shader as pos * posScale + posOffset.
+ */
+struct PackedVertices
+{
+    std::vector<VertexP>                        vertices;
+    glm::vec3                                   posScale;
+    glm::vec3                                   posOffset;
+};
+
+glm::vec2 OctEncode(const glm::vec3 &normal);
+PackedVertices PackVertices(const VertexN *vertices, size_t count);
+
+#endif
@@ -3,8 +3,10 @@
 layout (location = 0) in vec3 position;
 
 uniform mat4 fullTransform;
+uniform vec3 posScale;
+uniform vec3 posOffset;
 
 void main()
 {
-    gl_Position = fullTransform * vec4(position, 1.0);
+    gl_Position = fullTransform * vec4(position * posScale + posOffset, 1.0);
 }
@@ -7,13 +7,29 @@ in vec4 fragPosLightSpace;
 
 out vec4 color;
 
-uniform vec3 basicColor;
-uniform vec3 lightColor;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+// Layouts match graphics/UniformBlocks.h
+layout (std140) uniform Frame
+{
+    mat4 lightSpaceTransform;
+    vec3 viewPos;
+} frame;
+
+layout (std140) uniform Light
+{
+    vec3 position;
+    vec3 color;
+} light;
+
+// Layer < 0: untextured, basicColor is used
+layout (std140) uniform Material
+{
+    vec4 uvTransform;
+    vec3 basicColor;
+    int textureLayer;
+} material;
 
-uniform sampler2D texture0;
 uniform sampler2D shadowMap;
+uniform sampler2DArray textureArray;
 
 float CalculateShadowFactor(vec4 fragPos)
 {
@@ -28,24 +44,29 @@ void main()
 {
     vec3 fragNormalN = normalize(fragNormal);
     vec3 myColor;
-    if (basicColor == vec3(0.0, 0.0, 0.0)) {
-        myColor = vec3(texture(texture0, fragTexCoords));
+    if (material.textureLayer >= 0) {
+        // Repeat inside the layer's used area; gradients of the unwrapped
+        // coordinates keep mip selection continuous across the wrap
+        vec2 scale = material.uvTransform.xy;
+        vec2 uv = fract(fragTexCoords) * scale + material.uvTransform.zw;
+        myColor = vec3(textureGrad(textureArray, vec3(uv, material.textureLayer),
+                dFdx(fragTexCoords) * scale, dFdy(fragTexCoords) * scale));
     } else {
-        myColor = basicColor;
+        myColor = material.basicColor;
     }
 
     // ambient
-    vec3 ambientColor = 0.1 * lightColor;
+    vec3 ambientColor = 0.1 * light.color;
 
     // diffuse
-    vec3 lightDir = normalize(lightPos - fragPosition);
-    vec3 diffuseColor = 0.8 * max(dot(lightDir, fragNormalN), 0.0) * lightColor;
+    vec3 lightDir = normalize(light.position - fragPosition);
+    vec3 diffuseColor = 0.8 * max(dot(lightDir, fragNormalN), 0.0) * light.color;
 
     // specular
-    vec3 viewDir = normalize(viewPos - fragPosition);
+    vec3 viewDir = normalize(frame.viewPos - fragPosition);
     vec3 reflectedDir = reflect(-lightDir, fragNormalN);
     float angleCos = max(dot(reflectedDir, viewDir), 0.0);
-    vec3 specularColor = 0.9 * pow(angleCos, 128) * lightColor;
+    vec3 specularColor = 0.9 * pow(angleCos, 128) * light.color;
 
 
     // shadow
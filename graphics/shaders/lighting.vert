@@ -9,16 +9,37 @@ out vec3 fragNormal;
 out vec3 fragPosition;
 out vec4 fragPosLightSpace;
 
+layout (std140) uniform Frame
+{
+    mat4 lightSpaceTransform;
+    vec3 viewPos;
+} frame;
+
 uniform mat4 fullTransform;
 uniform mat4 modelTransform;
-uniform mat4 lightSpaceTransform;
+
+// Packed meshes: quantized positions and octahedral normals
+uniform vec3 posScale;
+uniform vec3 posOffset;
+uniform bool octNormals;
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 void main()
 {
+    vec3 objPosition = position * posScale + posOffset;
+    vec3 objNormal = octNormals ? OctDecode(normal.xy) : normal;
     fragTexCoords = texCoords;
-    fragPosition = vec3(modelTransform * vec4(position, 1.0));
-    fragNormal = mat3(transpose(inverse(modelTransform))) * normal;
-    fragPosLightSpace = lightSpaceTransform * vec4(fragPosition, 1.0);
-    gl_Position = fullTransform * vec4(position, 1.0);
+    fragPosition = vec3(modelTransform * vec4(objPosition, 1.0));
+    fragNormal = mat3(transpose(inverse(modelTransform))) * objNormal;
+    fragPosLightSpace = frame.lightSpaceTransform * vec4(fragPosition, 1.0);
+    gl_Position = fullTransform * vec4(objPosition, 1.0);
 }
 
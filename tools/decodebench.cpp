@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../graphics/Image.h"
+#include "../graphics/ImageDecoder.h"
+#include "../graphics/MappedFile.h"
+
+/*
+ * Images per second for every decoder, on one thread and as a parallel
+ * batch over all cores. Pass larger images to compare beyond gold.jpg.
+ * Usage: decodebench [image...]
+ */
+
+static const double MIN_SECONDS = 0.5;
+
+template <class F>
+static double MeasureImagesPerSecond(F decode)
+{
+    size_t count = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double> elapsed{0.0};
+    while (elapsed.count() < MIN_SECONDS) {
+        count += decode();
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    return count / elapsed.count();
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> paths(argv + 1, argv + argc);
+    if (paths.empty()) {
+        paths.push_back("res/gold.jpg");
+    }
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::printf("%-24s %12s %-10s %12s %12s %12s\n", "image", "size", "decoder", "img/s",
+            "MPix/s", "img/s xN");
+    for (const std::string &path : paths) {
+        MappedFile file(path, false);
+        if (!file.IsOpen()) {
+            std::fprintf(stderr, "Cannot open %s\n", path.c_str());
+            continue;
+        }
+        for (const ImageDecoder *decoder : ImageDecoder::GetDecoders()) {
+            if (!decoder->CanDecode(file.Data(), file.Size())) {
+                continue;
+            }
+            Image image;
+            if (!decoder->Decode(file.Data(), file.Size(), image)) {
+                std::fprintf(stderr, "%s failed on %s\n", decoder->GetName(), path.c_str());
+                continue;
+            }
+            double single = MeasureImagesPerSecond([&]() {
+                return decoder->Decode(file.Data(), file.Size(), image) ? 1 : 0;
+            });
+            std::vector<std::string> batch(threads * 4, path);
+            std::vector<Image> images;
+            double parallel = MeasureImagesPerSecond([&]() {
+                return DecodeImages(batch, images, threads, decoder);
+            });
+            std::string size = std::to_string(image.width) + "x" + std::to_string(image.height);
+            std::printf("%-24s %12s %-10s %12.1f %12.1f %12.1f\n", path.c_str(), size.c_str(),
+                    decoder->GetName(), single,
+                    single * image.width * image.height / 1e6, parallel);
+        }
+    }
+    std::printf("parallel mode used %u threads\n", threads);
+    return 0;
+}
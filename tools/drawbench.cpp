@@ -0,0 +1,153 @@
+#include <GL/glew.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../graphics/Shader.h"
+
+/*
+ * CPU cost of the uniforms Entity::Draw sets, by name and by UniformId,
+ * for the lighting shader. GL entry points are replaced by no-ops, so no
+ * context is needed and only the Shader side is measured.
+ * Usage: drawbench [entities]
+ */
+
+static const int FRAMES = 100;
+
+// Uniform names the no-op program knows; locations are their indices
+static const char *const s_uniforms[] = {
+    "modelTransform", "fullTransform", "octNormals", "posScale", "posOffset"
+};
+
+static GLuint APIENTRY NoCreate() { return 1; }
+static GLuint APIENTRY NoCreateShader(GLenum) { return 1; }
+static void APIENTRY NoDelete(GLuint) {}
+static void APIENTRY NoAttach(GLuint, GLuint) {}
+static void APIENTRY NoShaderSource(GLuint, GLsizei, const GLchar *const *, const GLint *) {}
+
+static void APIENTRY NoGetShaderiv(GLuint, GLenum, GLint *value)
+{
+    *value = GL_TRUE;
+}
+
+// Linked, no attributes
+static void APIENTRY NoGetProgramiv(GLuint, GLenum name, GLint *value)
+{
+    *value = name == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+
+static GLuint APIENTRY NoGetUniformBlockIndex(GLuint, const GLchar *)
+{
+    return GL_INVALID_INDEX;
+}
+
+static GLint APIENTRY NoGetUniformLocation(GLuint, const GLchar *name)
+{
+    for (size_t i = 0; i < sizeof(s_uniforms) / sizeof(s_uniforms[0]); ++i) {
+        if (std::strcmp(name, s_uniforms[i]) == 0) {
+            return static_cast<GLint>(i);
+        }
+    }
+    return -1;
+}
+
+static void APIENTRY NoUniform1i(GLint, GLint) {}
+static void APIENTRY NoUniformfv(GLint, GLsizei, const GLfloat *) {}
+static void APIENTRY NoUniformMatrix(GLint, GLsizei, GLboolean, const GLfloat *) {}
+
+// GLEW's entry points are plain function pointers until glewInit() fills them
+static void InstallNoOpGl()
+{
+    glCreateProgram = NoCreate;
+    glCreateShader = NoCreateShader;
+    glDeleteProgram = NoDelete;
+    glDeleteShader = NoDelete;
+    glCompileShader = NoDelete;
+    glLinkProgram = NoDelete;
+    glUseProgram = NoDelete;
+    glAttachShader = NoAttach;
+    glShaderSource = NoShaderSource;
+    glGetShaderiv = NoGetShaderiv;
+    glGetProgramiv = NoGetProgramiv;
+    glGetUniformBlockIndex = NoGetUniformBlockIndex;
+    glGetUniformLocation = NoGetUniformLocation;
+    glUniform1i = NoUniform1i;
+    glUniform3fv = NoUniformfv;
+    glUniform4fv = NoUniformfv;
+    glUniformMatrix4fv = NoUniformMatrix;
+}
+
+struct BenchEntity
+{
+    glm::mat4                                   model;
+    glm::vec3                                   posScale;
+    glm::vec3                                   posOffset;
+};
+
+// As Entity::Draw for the lighting shader: entities sharing a mesh, each with its own transform
+template <class F>
+static double MeasureNs(const std::vector<BenchEntity> &entities, F draw)
+{
+    glm::mat4 pv = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        pv = glm::rotate(pv, 0.01f, glm::vec3(0.0, 1.0, 0.0));
+        for (const BenchEntity &entity : entities) {
+            draw(entity, pv);
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (double(FRAMES) * entities.size());
+}
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? std::atoi(argv[1]) : 10000;
+    if (count <= 0) {
+        std::fprintf(stderr, "Usage: %s [entities]\n", argv[0]);
+        return 1;
+    }
+
+    InstallNoOpGl();
+    Shader shader("graphics/shaders/lighting.vert", "graphics/shaders/lighting.frag");
+    if (!shader.Poll()) {
+        std::fprintf(stderr, "Could not build the no-op program\n");
+        return 1;
+    }
+
+    std::vector<BenchEntity> entities(count);
+    for (int i = 0; i < count; ++i) {
+        entities[i].model = glm::translate(glm::mat4(1.0), glm::vec3(i % 100, 0.0, i / 100));
+        entities[i].posScale = glm::vec3(1.0);
+        entities[i].posOffset = glm::vec3(0.0);
+    }
+
+    double byName = MeasureNs(entities, [&](const BenchEntity &e, const glm::mat4 &pv) {
+        shader.SetUniform("modelTransform", e.model);
+        shader.SetUniform("octNormals", 1);
+        shader.SetUniform("fullTransform", pv * e.model);
+        shader.SetUniform("posScale", e.posScale);
+        shader.SetUniform("posOffset", e.posOffset);
+        shader.Use();
+    });
+    double byId = MeasureNs(entities, [&](const BenchEntity &e, const glm::mat4 &pv) {
+        shader.SetUniform(UNIFORM_MODEL_TRANSFORM, e.model);
+        shader.SetUniform(UNIFORM_OCT_NORMALS, 1);
+        shader.SetUniform(UNIFORM_FULL_TRANSFORM, pv * e.model);
+        shader.SetUniform(UNIFORM_POS_SCALE, e.posScale);
+        shader.SetUniform(UNIFORM_POS_OFFSET, e.posOffset);
+        shader.Use();
+    });
+
+    std::printf("%d entities x %d frames, Entity::Draw uniforms\n", count, FRAMES);
+    std::printf("%-12s %12s\n", "path", "ns per draw");
+    std::printf("%-12s %12.1f\n", "by name", byName);
+    std::printf("%-12s %12.1f\n", "by id", byId);
+    return 0;
+}
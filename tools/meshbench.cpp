@@ -0,0 +1,95 @@
+#include <GL/glew.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../ReadMesh.h"
+
+/*
+ * Compares the old iostream mesh parser with ReadMesh on generated meshes.
+ * Usage: meshbench [maxVertices]
+ */
+
+// The parser ReadMesh used before switching to std::from_chars
+static std::pair<std::vector<VertexN>, std::vector<GLuint>> ReadMeshStream(const std::string &path)
+{
+    std::fstream file;
+    std::vector<VertexN> V;
+    std::vector<GLuint> I;
+    file.open(path);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    unsigned n;
+    ss >> n;
+    for (unsigned i = 0; i < n; ++i) {
+        glm::vec3 p;
+        glm::vec2 tc;
+        glm::vec3 normal;
+        ss >> p.x >> p.y >> p.z >> tc.x >> tc.y >>
+                normal.x >> normal.y >> normal.z;
+        V.push_back({p, tc, normal});
+    }
+    ss >> n;
+    for (unsigned i = 0; i < n; ++i) {
+        GLuint ind;
+        ss >> ind;
+        I.push_back(ind);
+    }
+    return {V, I};
+}
+
+static void GenerateMesh(const std::string &path, unsigned vertexCount)
+{
+    FILE *file = std::fopen(path.c_str(), "w");
+    std::fprintf(file, "%u\n", vertexCount);
+    for (unsigned i = 0; i < vertexCount; ++i) {
+        float t = static_cast<float>(i) / vertexCount;
+        std::fprintf(file, "%.6f %.6f %.6f  %.4f %.4f  %.4f %.4f %.4f\n",
+                t * 10.0f - 5.0f, t * 3.0f, 1.0f - t, t, 1.0f - t, 0.0f, 1.0f, 0.0f);
+    }
+    std::fprintf(file, "0\n");
+    std::fclose(file);
+}
+
+template <class F>
+static double MeasureMBps(F parse, double sizeMB, size_t expected)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto p = parse();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (p.first.size() != expected) {
+        std::cerr << "Parsed " << p.first.size() << " vertices, expected " <<
+                expected << std::endl;
+        std::exit(1);
+    }
+    return sizeMB / elapsed.count();
+}
+
+int main(int argc, char **argv)
+{
+    unsigned maxVertices = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string path = (std::filesystem::temp_directory_path() / "meshbench.mesh").string();
+
+    std::printf("%10s %10s %12s %12s %12s\n", "vertices", "MB", "stream MB/s",
+            "chars MB/s", "chars xN MB/s");
+    for (unsigned n = 10000; n <= maxVertices; n *= 10) {
+        GenerateMesh(path, n);
+        double sizeMB = std::filesystem::file_size(path) / (1024.0 * 1024.0);
+        double stream = MeasureMBps([&]() { return ReadMeshStream(path); }, sizeMB, n);
+        double chars = MeasureMBps([&]() { return ReadMesh(path, 1); }, sizeMB, n);
+        double parallel = MeasureMBps([&]() { return ReadMesh(path, threads); }, sizeMB, n);
+        std::printf("%10u %10.1f %12.1f %12.1f %12.1f\n", n, sizeMB, stream, chars, parallel);
+    }
+    std::printf("parallel mode used %u threads\n", threads);
+    std::filesystem::remove(path);
+    return 0;
+}
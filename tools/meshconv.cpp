@@ -0,0 +1,38 @@
+#include <GL/glew.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "../ReadMesh.h"
+#include "../graphics/MeshFile.h"
+#include "../graphics/MeshOptimize.h"
+
+/*
+ * Converts a text .mesh file into the binary .meshb container.
+ * -O deduplicates vertices and optimizes the mesh for the vertex cache.
+ */
+int main(int argc, char **argv)
+{
+    bool optimize = argc == 4 && std::strcmp(argv[1], "-O") == 0;
+    if (argc != 3 + optimize) {
+        std::cerr << "Usage: " << argv[0] << " [-O] <input.mesh> <output.meshb>" << std::endl;
+        return 1;
+    }
+    const char *input = argv[1 + optimize];
+    const char *output = argv[2 + optimize];
+    auto p = ReadMesh(input);
+    if (p.first.empty()) {
+        std::cerr << "Mesh is empty: " << input << std::endl;
+        return 1;
+    }
+    if (optimize) {
+        OptimizeMesh(input, p.first, p.second);
+    }
+    if (!MeshFile::Write(output, p.first, p.second)) {
+        return 1;
+    }
+    std::cout << output << ": " << p.first.size() << " vertices, " <<
+            p.second.size() << " indices" << std::endl;
+    return 0;
+}
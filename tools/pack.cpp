@@ -0,0 +1,20 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../graphics/Bundle.h"
+
+// Packs files into an asset bundle, names are stored as given
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <output.pak> <file>..." << std::endl;
+        return 1;
+    }
+    std::vector<std::string> files(argv + 2, argv + argc);
+    if (!Bundle::Write(argv[1], files)) {
+        return 1;
+    }
+    std::cout << argv[1] << ": " << files.size() << " files" << std::endl;
+    return 0;
+}
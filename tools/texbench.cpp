@@ -0,0 +1,110 @@
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../graphics/BlockCompress.h"
+#include "../graphics/Image.h"
+#include "../graphics/MipChain.h"
+#include "../graphics/Texture.h"
+#include "../graphics/TextureFile.h"
+
+/*
+ * Uploads the same image with its mip chain as RGBA8 and from BC1/BC3/BC7
+ * KTX2 files, and prints upload time and GPU bytes for each. Needs a GL
+ * context, an invisible window is created for it.
+ * Usage: texbench [image]
+ */
+
+static const int UPLOADS = 50;
+
+namespace fs = std::filesystem;
+
+template <class F>
+static double MeasureMs(F upload, size_t &bytes)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < UPLOADS; ++i) {
+        Texture texture = upload();
+        bytes = texture.GetMemorySize();
+    }
+    // Uploads are asynchronous, count them as done once the driver is idle
+    glFinish();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / UPLOADS;
+}
+
+static bool WriteKtx2(const std::string &path, const std::vector<Image> &images, uint32_t format)
+{
+    std::vector<std::vector<unsigned char>> data;
+    std::vector<TextureLevel> levels;
+    for (const Image &image : images) {
+        data.push_back(CompressImage(image, format));
+        levels.push_back({image.width, image.height, data.back().data(), data.back().size()});
+    }
+    return TextureFile::Write(path, format, levels);
+}
+
+int main(int argc, char **argv)
+{
+    std::string path = argc > 1 ? argv[1] : "res/gold.jpg";
+    Image base;
+    if (!DecodeImage(path, base)) {
+        return 1;
+    }
+    std::vector<Image> images = BuildMipChain(base);
+    images.insert(images.begin(), std::move(base));
+
+    if (!glfwInit()) {
+        std::fprintf(stderr, "Could not initialize GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    GLFWwindow *window = glfwCreateWindow(64, 64, "texbench", nullptr, nullptr);
+    if (!window) {
+        std::fprintf(stderr, "Could not create a GL context\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    if (glewInit() != GLEW_OK) {
+        std::fprintf(stderr, "Could not initialize GLEW\n");
+        glfwTerminate();
+        return 1;
+    }
+
+    std::printf("%-24s %10s %-8s %12s %12s\n", "image", "size", "format", "upload ms", "KiB");
+    std::string size = std::to_string(images[0].width) + "x" + std::to_string(images[0].height);
+    size_t bytes = 0;
+    double ms = MeasureMs([&]() { return Texture(images); }, bytes);
+    std::printf("%-24s %10s %-8s %12.3f %12zu\n", path.c_str(), size.c_str(), "RGBA8", ms,
+            bytes / 1024);
+
+    struct Format { uint32_t format; const char *name; };
+    for (Format f : {Format{KTX2_FORMAT_BC1_RGBA_UNORM, "BC1"},
+            Format{KTX2_FORMAT_BC3_UNORM, "BC3"}, Format{KTX2_FORMAT_BC7_UNORM, "BC7"}}) {
+        std::string ktx = (fs::temp_directory_path() / "texbench.ktx2").string();
+        if (!WriteKtx2(ktx, images, f.format)) {
+            continue;
+        }
+        {
+            TextureFile file(ktx);
+            const char *note = Texture::IsFormatSupported(f.format) ? "" : " (CPU decoded)";
+            ms = MeasureMs([&]() { return Texture(file); }, bytes);
+            std::printf("%-24s %10s %-8s %12.3f %12zu%s\n", path.c_str(), size.c_str(), f.name,
+                    ms, bytes / 1024, note);
+        }
+        fs::remove(ktx);
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../graphics/BlockCompress.h"
+#include "../graphics/Image.h"
+#include "../graphics/MipChain.h"
+#include "../graphics/TextureFile.h"
+
+/*
+ * Builds the mip chain of an image and stores it in a KTX2 container.
+ * Usage: texconv [-bc1|-bc3|-bc7|-rgba8] <input image> <output.ktx2>
+ */
+int main(int argc, char **argv)
+{
+    uint32_t format = KTX2_FORMAT_BC1_RGBA_UNORM;
+    int arg = 1;
+    if (argc == 4) {
+        if (std::strcmp(argv[1], "-bc1") == 0) {
+            format = KTX2_FORMAT_BC1_RGBA_UNORM;
+        } else if (std::strcmp(argv[1], "-bc3") == 0) {
+            format = KTX2_FORMAT_BC3_UNORM;
+        } else if (std::strcmp(argv[1], "-bc7") == 0) {
+            format = KTX2_FORMAT_BC7_UNORM;
+        } else if (std::strcmp(argv[1], "-rgba8") == 0) {
+            format = KTX2_FORMAT_R8G8B8A8_UNORM;
+        } else {
+            std::cerr << "Unknown format: " << argv[1] << std::endl;
+            return 1;
+        }
+        arg = 2;
+    } else if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " [-bc1|-bc3|-bc7|-rgba8] <input> <output.ktx2>" <<
+                std::endl;
+        return 1;
+    }
+
+    Image base;
+    if (!DecodeImage(argv[arg], base)) {
+        return 1;
+    }
+    std::vector<Image> images = BuildMipChain(base);
+    images.insert(images.begin(), std::move(base));
+
+    std::vector<std::vector<unsigned char>> data;
+    std::vector<TextureLevel> levels;
+    size_t rgbaSize = 0, size = 0;
+    for (const Image &image : images) {
+        if (format == KTX2_FORMAT_R8G8B8A8_UNORM) {
+            data.push_back(image.pixels);
+        } else {
+            data.push_back(CompressImage(image, format));
+        }
+        levels.push_back({image.width, image.height, data.back().data(), data.back().size()});
+        rgbaSize += image.pixels.size();
+        size += data.back().size();
+    }
+    if (!TextureFile::Write(argv[arg + 1], format, levels)) {
+        return 1;
+    }
+    std::cout << argv[arg + 1] << ": " << levels.size() << " levels, " << size << " bytes (" <<
+            rgbaSize << " as RGBA8)" << std::endl;
+    return 0;
+}
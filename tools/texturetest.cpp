@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../graphics/BlockCompress.h"
+#include "../graphics/Image.h"
+#include "../graphics/MipChain.h"
+#include "../graphics/TextureFile.h"
+
+/*
+ * CPU-only checks of the texture pipeline: BC1/BC3/BC7 encode -> decode error
+ * and KTX2 write -> read round trips, including rejection of damaged files.
+ * Usage: texturetest [image]
+ */
+
+namespace fs = std::filesystem;
+
+// Worst acceptable RMS error per channel, in 8-bit units
+static const double MAX_COLOR_RMSE = 12.0;
+static const double MAX_ALPHA_RMSE = 4.0;
+// BC7 mode 6 interpolates alpha along the colour line instead of on its own
+static const double MAX_BC7_ALPHA_RMSE = 6.0;
+
+static int s_failures = 0;
+
+static void Check(bool ok, const std::string &what)
+{
+    std::printf("%-56s %s\n", what.c_str(), ok ? "ok" : "FAILED");
+    if (!ok) {
+        ++s_failures;
+    }
+}
+
+// Smooth colour and alpha ramps with a few hard edges
+static Image MakeTestImage(int width, int height)
+{
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(size_t(width) * height * 4);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            unsigned char *p = &image.pixels[(size_t(y) * width + x) * 4];
+            p[0] = x * 255 / std::max(1, width - 1);
+            p[1] = y * 255 / std::max(1, height - 1);
+            p[2] = (x / 8 + y / 8) % 2 ? 200 : 40;
+            p[3] = (x + y) * 255 / std::max(1, width + height - 2);
+        }
+    }
+    return image;
+}
+
+// RMS error of channels [first, last)
+static double Rmse(const Image &a, const Image &b, int first, int last)
+{
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t i = 0; i < a.pixels.size(); i += 4) {
+        for (int c = first; c < last; ++c) {
+            double d = double(a.pixels[i + c]) - b.pixels[i + c];
+            sum += d * d;
+            ++count;
+        }
+    }
+    return count ? std::sqrt(sum / count) : 0.0;
+}
+
+static void CheckBlockCompression(const std::string &name, const Image &image)
+{
+    struct Format { uint32_t format; const char *name; double maxAlpha; };
+    for (Format f : {Format{KTX2_FORMAT_BC1_RGBA_UNORM, "BC1", 0.0},
+            Format{KTX2_FORMAT_BC3_UNORM, "BC3", MAX_ALPHA_RMSE},
+            Format{KTX2_FORMAT_BC7_UNORM, "BC7", MAX_BC7_ALPHA_RMSE}}) {
+        std::vector<unsigned char> blocks = CompressImage(image, f.format);
+        Image decoded;
+        bool ok = blocks.size() == CompressedSize(image.width, image.height, f.format) &&
+                DecompressImage(blocks.data(), image.width, image.height, f.format, decoded);
+        Check(ok, name + " " + f.name + " encode/decode");
+        if (!ok) {
+            continue;
+        }
+        double color = Rmse(image, decoded, 0, 3);
+        char what[128];
+        std::snprintf(what, sizeof(what), "%s %s colour RMSE %.2f", name.c_str(), f.name, color);
+        Check(color <= MAX_COLOR_RMSE, what);
+        if (f.maxAlpha > 0.0) {
+            double alpha = Rmse(image, decoded, 3, 4);
+            std::snprintf(what, sizeof(what), "%s %s alpha RMSE %.2f", name.c_str(), f.name,
+                    alpha);
+            Check(alpha <= f.maxAlpha, what);
+        }
+    }
+}
+
+static void CheckRoundTrip(const std::string &name, const Image &base, uint32_t format,
+        const std::string &path)
+{
+    std::vector<Image> images = BuildMipChain(base);
+    images.insert(images.begin(), base);
+    std::vector<std::vector<unsigned char>> data;
+    std::vector<TextureLevel> levels;
+    for (const Image &image : images) {
+        data.push_back(format == KTX2_FORMAT_R8G8B8A8_UNORM ? image.pixels :
+                CompressImage(image, format));
+        levels.push_back({image.width, image.height, data.back().data(), data.back().size()});
+    }
+
+    std::string what = name + " KTX2 format " + std::to_string(format);
+    bool ok = TextureFile::Write(path, format, levels);
+    {
+        TextureFile file(path);
+        ok = ok && file.IsOpen() && file.GetFormat() == format &&
+                file.GetLevelCount() == levels.size();
+        for (size_t i = 0; ok && i < levels.size(); ++i) {
+            TextureLevel level = file.GetLevel(i);
+            ok = level.width == levels[i].width && level.height == levels[i].height &&
+                    level.size == levels[i].size &&
+                    std::equal(data[i].begin(), data[i].end(), level.data);
+        }
+    }
+    Check(ok, what + " round trip");
+
+    // Every consumer reads whole levels, so a short file must not open
+    fs::resize_file(path, fs::file_size(path) - 1);
+    Check(!TextureFile(path).IsOpen(), what + " truncated file rejected");
+    fs::remove(path);
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::pair<std::string, Image>> images;
+    images.emplace_back("ramp 64x64", MakeTestImage(64, 64));
+    images.emplace_back("ramp 37x13", MakeTestImage(37, 13));
+    Image file;
+    std::string path = argc > 1 ? argv[1] : "res/gold.jpg";
+    if (DecodeImage(path, file)) {
+        images.emplace_back(path, std::move(file));
+    }
+
+    std::string ktx = (fs::temp_directory_path() / "texturetest.ktx2").string();
+    for (const auto &[name, image] : images) {
+        CheckBlockCompression(name, image);
+        for (uint32_t format : {KTX2_FORMAT_R8G8B8A8_UNORM, KTX2_FORMAT_BC1_RGBA_UNORM,
+                KTX2_FORMAT_BC3_UNORM, KTX2_FORMAT_BC7_UNORM}) {
+            CheckRoundTrip(name, image, format, ktx);
+        }
+    }
+
+    if (s_failures) {
+        std::printf("%d checks failed\n", s_failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}